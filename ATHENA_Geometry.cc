@@ -1,5 +1,7 @@
 #include "DetectorConstruction.hh"
 #include "ActionInitialization.hh"
+#include "ReadoutWorld.hh"
+#include "VisLevelOfDetail.hh"
 
 #include "G4RunManagerFactory.hh"
 
@@ -73,13 +75,21 @@ int main(int argc,char** argv)
 
   // Set mandatory initialization classes
   //
-  runManager->SetUserInitialization(new DetectorConstruction());
-  runManager->SetUserInitialization(new FTFP_BERT_HP);
+  // The readout cells live in a parallel world, see ReadoutWorld. It registers
+  // itself and its physics once /athena/readout/ enables it, before /run/initialize.
+  auto detector = new DetectorConstruction();
+  runManager->SetUserInitialization(detector);
+
+  auto physicsList = new FTFP_BERT_HP;
+  runManager->SetUserInitialization(physicsList);
+  auto readoutWorld = new ReadoutWorld("ReadoutWorld");
+  readoutWorld->SetRegistration(detector, physicsList);
   runManager->SetUserInitialization(new ActionInitialization());
   
   // Initialize visualization
   auto visManager = new G4VisExecutive;
   visManager->Initialize();
+  auto visLOD = new VisLevelOfDetail; // /athena/vis/lod
 
   // Get the pointer to the User Interface manager
   auto UImanager = G4UImanager::GetUIpointer();
@@ -101,6 +111,7 @@ int main(int argc,char** argv)
     delete ui;
   }
 
+  delete visLOD;
   delete visManager;
   delete runManager;
 }
@@ -0,0 +1,72 @@
+#!/bin/bash
+# Before/after report of the ECal fiber placement and navigation on the mymac_WScFi.mac workload:
+# construction time and memory, geometry inventory and events/s per configuration, and the
+# per-step speed-up of the lattice navigation from /athena/geometry/benchmarkNavigation.
+# Each run keeps its macro and log in bench/<name>/, a failed run is reported with the end of its log.
+# Usage: ./benchmark.sh [num_events] [num_threads] [num_tracks]
+set -o errexit
+
+filename="mymac_WScFi.mac"
+num_events=${1:-1000}
+num_threads=${2:-1}
+num_tracks=${3:-10000}
+
+# fiberPlacement:fiberNavigation
+configs=(placement:voxel parameterised:voxel parameterised:lattice)
+report=$(pwd)/benchmark_report.txt
+failed=0
+
+# Run the macro of bench/$1 with $2 threads, 1 if the job failed
+run_job() {
+  cd bench/$1
+  local status=0
+  ../../build/ATHENA_Geometry -m $filename -t $2 > log.txt 2>&1 || status=$?
+  cd ../..
+  if [ $status -ne 0 ]; then
+    echo "FAILED with exit status ${status}, end of bench/$1/log.txt:" >> ${report}
+    tail -n 20 bench/$1/log.txt >> ${report}
+    failed=1
+    return 1
+  fi
+}
+
+echo "ECal fiber benchmark, ${num_events} events of ${filename}, ${num_threads} thread(s)" > ${report}
+
+for config in ${configs[@]}
+do
+  placement=${config%:*}
+  navigation=${config#*:}
+  name=${placement}_${navigation}
+  mkdir -p bench/${name}
+
+  macro=bench/${name}/$filename
+  cp $filename ${macro}
+  sed -i "s/^#*\/athena\/geometry\/fiberPlacement .*/\/athena\/geometry\/fiberPlacement ${placement}/" ${macro}
+  sed -i "s/^#*\/athena\/geometry\/fiberNavigation .*/\/athena\/geometry\/fiberNavigation ${navigation}/" ${macro}
+  sed -i "s/\/analysis\/setFileName .*/\/analysis\/setFileName bench_${name}/" ${macro}
+  sed -i "s/\/run\/beamOn .*/\/run\/beamOn ${num_events}/" ${macro}
+
+  echo "" >> ${report}
+  echo "=== fiberPlacement ${placement}, fiberNavigation ${navigation}" >> ${report}
+  run_job ${name} ${num_threads} || continue
+  grep -A 20 "^Geometry construction profile" bench/${name}/log.txt \
+    | grep -B 20 -m 1 "^Geometry inventory" >> ${report} || true
+  grep "performance:" bench/${name}/log.txt | tail -n 1 >> ${report} || true
+done
+
+# Time per step of the voxel and lattice navigation on the same tracks, on the closed geometry
+mkdir -p bench/navigation
+macro=bench/navigation/$filename
+cp $filename ${macro}
+sed -i "s/^#*\/athena\/geometry\/fiberPlacement .*/\/athena\/geometry\/fiberPlacement parameterised/" ${macro}
+sed -i "s/\/analysis\/setFileName .*/\/analysis\/setFileName bench_navigation/" ${macro}
+sed -i "s/^\/run\/beamOn .*/\/run\/beamOn 0\n\/athena\/geometry\/benchmarkNavigation ${num_tracks}/" ${macro}
+
+echo "" >> ${report}
+echo "=== benchmarkNavigation ${num_tracks}" >> ${report}
+if run_job navigation 1; then
+  grep -A 4 "^ECal fiber navigation benchmark" bench/navigation/log.txt >> ${report} || true
+fi
+
+cat ${report}
+exit ${failed}
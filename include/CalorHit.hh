@@ -10,16 +10,24 @@
 #include "G4Allocator.hh"
 #include "G4ThreeVector.hh"
 #include "G4Threading.hh"
+#include "CellID.hh"
 
 /// Calorimeter hit class
 ///
 /// It defines data members to store the the energy deposit and track lengths
 /// of charged particles in a selected volume:
 /// - fEdep, fTrackLength
+/// and the CellID of that volume. With integration windows
+/// (GlobalValues::NumTimeWindows) the energy is also split by window.
+/// Cells of fibers with a light model (CalorimeterSD::SetFiberResponse())
+/// also count photoelectrons: the mean while stepping, the Poisson-sampled
+/// number at the end of the event.
 
 class CalorHit : public G4VHit
 {
   public:
+    static const G4int kMaxTimeWindows = 8;
+
     CalorHit();
     CalorHit(const CalorHit&);
     virtual ~CalorHit();
@@ -36,17 +44,27 @@ class CalorHit : public G4VHit
     virtual void Print();
 
     // methods to handle data
-    void Add(G4double de, G4double dl);
+    void Add(G4double de, G4double dl, G4int nSteps = 1);
+    void AddInWindow(G4int window, G4double de) { fWindowEdep[window] += de; }
+    void AddPhotoelectrons(G4double npe) { fPhotoelectrons += npe; }
+    void SetPhotoelectrons(G4double npe) { fPhotoelectrons = npe; }
+    void SetCellID(CellID::Type id) { fCellID = id; }
 
     // get methods
     G4double GetEdep() const;
+    G4double GetEdep(G4int window) const { return fWindowEdep[window]; }
     G4double GetTrackLength() const;
     G4int GetNumHits() const;
+    G4double GetPhotoelectrons() const { return fPhotoelectrons; }
+    CellID::Type GetCellID() const { return fCellID; }
       
   private:
     G4double fEdep;        ///< Energy deposit in the sensitive volume
     G4double fTrackLength; ///< Track length in the  sensitive volume
     G4int fNumHits; // Number of hits in the sensitive volume
+    CellID::Type fCellID; // 0 for the hit holding the totals
+    G4double fWindowEdep[kMaxTimeWindows]; // Energy deposit per integration window
+    G4double fPhotoelectrons; // Photoelectrons at the fiber readout
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -75,10 +93,10 @@ inline void CalorHit::operator delete(void *hit)
   CalorHitAllocator->FreeSingle((CalorHit*) hit);
 }
 
-inline void CalorHit::Add(G4double de, G4double dl) {
+inline void CalorHit::Add(G4double de, G4double dl, G4int nSteps) {
   fEdep += de; 
   fTrackLength += dl;
-  fNumHits++;
+  fNumHits += nSteps;
 }
 
 inline G4double CalorHit::GetEdep() const { 
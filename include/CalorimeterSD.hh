@@ -8,25 +8,109 @@
 #include "G4VSensitiveDetector.hh"
 
 #include "CalorHit.hh"
+#include "CellHitMap.hh"
+#include "Quenching.hh"
+
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 class G4Step;
 class G4HCofThisEvent;
+class G4LogicalVolume;
+class G4Material;
 class DetectorConstruction;
 
 /// Calorimeter sensitive detector class
 ///
-/// In Initialize(), it creates one hit for each calorimeter layer and one more
-/// hit for accounting the total quantities in all layers.
+/// In Initialize(), it creates the hit for accounting the total quantities,
+/// which is entry 0 of the collection. A hit for a cell is only created at
+/// the first step in that cell, so the collection holds the touched cells in
+/// the order they were touched and the cost per event does not depend on the
+/// number of cells.
 ///
 /// The values are accounted in hits in ProcessHits() function which is called
 /// by Geant4 kernel at each step.
+///
+/// One SD serves all nofXY x nofXY towers (blocks) of a subsystem through a
+/// shared logical volume, placed with copy number CellID::CopyNumber(i, j).
+/// The cell index is computed from copy numbers in the touchable:
+///   cell = (i*nofXY + j)*nofLayers + copyNo(layerDepth)
+/// where i, j are decoded from copyNo(cellDepth) and layerDepth < 0 means the
+/// cell has no layer segmentation. Each hit carries its CellID.
+///
+/// Fibers can be grouped into cells inside a block: with SetFiberGroups() the
+/// fibers of a volume with a fiber depth (SetFiberDepth()) are numbered
+/// row*nofCols + col by the copy number at that depth, and rowsPerGroup x
+/// colsPerGroup of them form one cell, whose group index + 1 is stored in the
+/// fiber field of the CellID. One fiber per group reads out every fiber.
+///
+/// The hit of a touched cell is found through a CellHitMap keyed by CellID,
+/// preallocated and cleared in proportion to the touched cells only.
+///
+/// With a subdivision n each tower (block) holds n x n cells, the cell
+/// indices along x and y are i*n + replica(subXDepth) and j*n + the replica
+/// number along y counted towards -y, like the blocks. This is used for the
+/// readout cells of ReadoutWorld.
+///
+/// In a parallel world the SD sees every step inside its cells. A list of mass
+/// volumes then restricts the scoring to steps in those volumes, taken from
+/// the mass-geometry step of the track, which also gives the material for
+/// Birks' law.
+///
+/// With integration windows (GlobalValues::NumTimeWindows) a step is scored
+/// only if its pre-step global time falls into a window, and its energy is
+/// also added to the window of the hit. Late deposits, e.g. of thermalising
+/// neutrons, are then dropped as by the electronics.
+///
+/// Fibers with a light model (SetFiberResponse(), SetOpticalVolume()) also
+/// count photoelectrons instead of transporting optical photons: the
+/// Birks-corrected energy times the light yield, attenuated from the step
+/// midpoint to the readout at the +z end of the fiber by linear interpolation
+/// in a table. EndOfEvent() replaces the mean of each cell by a Poisson
+/// sample, which is the sum of the Poisson samples of its steps.
+///
+/// The quenching model (see Quenching) is chosen per material with
+/// SetQuenching(), other materials follow Birks' law with the Birks constant
+/// of the material (none for 0).
+///
+/// With SetBatchSize() the steps are deferred: ProcessHits() only finds the
+/// hit and stores the step in per-thread arrays (structure of arrays), one
+/// batch per quenching model. FlushBatch() quenches, scales and converts to
+/// photoelectrons each batch in the branch-free loop of its model
+/// (Quenching::Apply()), then adds it to the hits and once to the totals.
+/// The batches are flushed when one is full and in EndOfEvent(). The
+/// tabulated batch holds the steps of one table, it is also flushed when a
+/// step of another table comes. Without batches every step is quenched by
+/// the function of its model, resolved when its volume is cached.
+///
+/// The (Birks-corrected) energy is multiplied by an energy scale, which is the
+/// sampling fraction when the SD is attached to homogenised ECal blocks.
+///
+/// An SD attached to several kinds of volumes, e.g. the fibers and the
+/// homogenised blocks of a mixed ECal, takes the cell depth of each kind from
+/// the logical volume of the touchable and the energy scale from the mass
+/// volume of the step, where set per volume.
+///
+/// These per-volume quantities (Birks constant of the material, energy scale,
+/// scoring of the mass volume and cell depth) are cached in a table indexed by
+/// the instance ID of the logical volume, filled at the first step in each
+/// volume and cleared by every setter. A step then costs two vector lookups
+/// instead of the map searches and the touchable / material / ionisation
+/// pointer chain. SetVolumeTable(false) looks them up at every step again,
+/// for SDBenchmark. The SDs are per thread, and so are their tables.
 
 class CalorimeterSD : public G4VSensitiveDetector
 {
   public:
     CalorimeterSD(const G4String& name, 
                      const G4String& hitsCollectionName, 
-                     G4int nofCells);
+                     CellID::Subsystem subsystem,
+                     G4int nofXY,
+                     G4int cellDepth = 1,
+                     G4int layerDepth = -1,
+                     G4int nofLayers = 1);
     virtual ~CalorimeterSD();
   
     // methods from base class
@@ -34,9 +118,114 @@ class CalorimeterSD : public G4VSensitiveDetector
     virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory* history);
     virtual void   EndOfEvent(G4HCofThisEvent* hitCollection);
 
+    // The SD is kept across geometry re-initialisations and reconfigured
+    void SetCellDepth(G4int cellDepth) { fCellDepth = cellDepth; fVolumeTable.clear(); }
+    void SetLayout(G4int nofXY, G4int nofLayers = 1);
+    void SetEnergyScale(G4double scale) { fEnergyScale = scale; fVolumeTable.clear(); }
+    void SetSubdivision(G4int n, G4int subXDepth, G4int subYDepth);
+    void SetMassVolumes(const std::vector<const G4LogicalVolume*>& volumes) { fMassVolumes = volumes; fVolumeTable.clear(); }
+
+    // Per-volume cell depth (touchable volume) and energy scale (mass volume)
+    void SetCellDepth(const G4LogicalVolume* volume, G4int cellDepth);
+    void SetEnergyScale(const G4LogicalVolume* massVolume, G4double scale);
+    void SetFiberDepth(const G4LogicalVolume* volume, G4int fiberDepth);
+    void SetOpticalVolume(const G4LogicalVolume* volume);
+    void ClearVolumeSettings();
+
+    // Quenching model of the steps in a material, the table (if any) is copied
+    void SetQuenching(const G4Material* material, const Quenching::Parameters& parameters);
+    void ClearQuenching();
+
+    // Cells of rowsPerGroup x colsPerGroup fibers of an nofRows x nofCols lattice, whole blocks for 0
+    void SetFiberGroups(G4int nofRows, G4int nofCols, G4int rowsPerGroup, G4int colsPerGroup);
+    G4int GetNofFiberGroups() const { return fNofFiberGroups; }
+
+    // Photoelectrons per MeV at the readout end, and attenuation at equal steps from the
+    // readout end (0) to the far end (fiberLength) of the fibers, no light model for 0
+    void SetFiberResponse(G4double lightYield, G4double fiberLength, const std::vector<G4double>& attenuation);
+
+    // Cache the per-volume quantities of ProcessHits (default), or look them up at every step
+    void SetVolumeTable(G4bool flag) { fUseVolumeTable = flag; fVolumeTable.clear(); }
+
+    // Defer the quenching and hit updates of up to size steps, 0 to process every step at once
+    void SetBatchSize(G4int size);
+    G4int GetBatchSize() const { return fBatchSize; }
+    void FlushBatch();
+
+    // Collect the hits of the following steps in the given collection, without
+    // an event, as Initialize() does with its own collection (SDBenchmark)
+    void SetHitsCollection(CalorHitsCollection* collection);
+
+    G4double GetEnergyScale() const { return fEnergyScale; }
+    G4double GetEnergyScale(const G4LogicalVolume* massVolume) const;
+
   private:
+    // Quantities of a logical volume, as touchable or as mass volume of a step
+    struct VolumeRecord
+    {
+      G4bool   valid = false;
+      G4bool   scored = false; // steps in this mass volume are scored
+      G4int    cellDepth = 0; // touchable depth of the cell volume
+      G4int    fiberDepth = -1; // touchable depth of the fiber, < 0 for none
+      G4bool   optical = false; // photoelectrons are counted in this volume
+      Quenching::Parameters quenching; // of the material
+      Quenching::Function quench = &Quenching::Quench<Quenching::None>; // of the model
+      G4double energyScale = 1.;
+    };
+
+    VolumeRecord MakeRecord(const G4LogicalVolume* volume) const;
+    const VolumeRecord& GetRecord(const G4LogicalVolume* volume);
+    G4double GetAttenuation(G4double distance) const;
+
+    // Deferred steps of one quenching model
+    struct StepBatch
+    {
+      G4int count = 0;
+      const Quenching::Table* table = nullptr; // of all steps, tabulated model only
+      std::vector<G4int>    hit; // collection entry
+      std::vector<G4int>    window;
+      std::vector<G4double> edep;
+      std::vector<G4double> length;
+      std::vector<G4double> dEdx;
+      std::vector<G4double> birks; // kB
+      std::vector<G4double> chou; // C
+      std::vector<G4double> scale;
+      std::vector<G4double> light; // photoelectrons per quenched MeV
+      std::vector<G4double> deposit; // results of the quenching loop
+      std::vector<G4double> npe;
+    };
+    template<class Policy> void FlushBatch(StepBatch& batch);
+
     CalorHitsCollection* fHitsCollection;
+    CellID::Subsystem fSubsystem;
+    G4int  fNofXY;
     G4int  fNofCells;
+    G4int  fCellDepth;
+    G4int  fLayerDepth;
+    G4int  fNofLayers;
+    G4double fEnergyScale;
+    G4int  fSubdivision; // cells per tower (block) side
+    G4int  fSubXDepth;
+    G4int  fSubYDepth;
+    std::vector<const G4LogicalVolume*> fMassVolumes; // scored mass volumes, all if empty
+    CellHitMap fHitIndex; // collection entry by CellID, this event
+    std::unordered_map<const G4LogicalVolume*, G4int> fVolumeCellDepths; // overrides of fCellDepth
+    std::unordered_map<const G4LogicalVolume*, G4int> fVolumeFiberDepths; // volumes read out per fiber group
+    std::vector<G4int> fFiberGroup; // group of each fiber, empty for whole blocks
+    G4int fNofFiberGroups;
+    std::unordered_set<const G4LogicalVolume*> fOpticalVolumes; // volumes with the light model
+    G4double fLightYield; // photoelectrons per MeV at the readout end, 0 for none
+    G4double fFiberHalfLength;
+    G4double fAttenuationStep; // distance between the entries of fAttenuation
+    std::vector<G4double> fAttenuation; // by distance to the readout end
+    std::unordered_map<const G4Material*, Quenching::Parameters> fMaterialQuenching;
+    std::map<const G4Material*, Quenching::Table> fQuenchingTables; // referenced by fMaterialQuenching
+    G4int fBatchSize; // deferred steps per model, 0 for none
+    StepBatch fBatches[Quenching::kNofModels];
+    std::unordered_map<const G4LogicalVolume*, G4double> fVolumeEnergyScales; // overrides of fEnergyScale
+    std::vector<VolumeRecord> fVolumeTable; // by logical-volume instance ID
+    VolumeRecord fRecordCopy; // record of the step without the volume table
+    G4bool fUseVolumeTable;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,106 @@
+/// \file CellGeometry.hh
+/// \brief Header-only lookup of the cell geometry table
+
+#ifndef CellGeometry_h
+#define CellGeometry_h 1
+
+#include "CellID.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// Cell centres and half sizes read from the table written next to each
+/// output file (<output>_cells.txt, see CellGeometryTable), for use in
+/// analysis code, e.g. a ROOT macro:
+///
+///   CellGeometry geometry("pi+_1GeV_cells.txt");
+///   auto cell = geometry.Find(ECal_CellID);
+///   if(cell) xSum += ECal_Edep_Block*cell->x;
+///
+/// The cells of each subsystem are stored in a dense array indexed by the
+/// x, y and layer fields of the CellID, so Find() is a few shifts and one
+/// array access. Lengths are in mm. The table has no fiber groups, so the
+/// sub-cells of ECalSubCells (Fiber() != 0) are not found.
+
+class CellGeometry
+{
+  public:
+    struct Cell
+    {
+      double x, y, z;    // centre
+      double dx, dy, dz; // half sizes
+    };
+
+    explicit CellGeometry(const std::string& fileName)
+    {
+      std::ifstream input(fileName);
+      std::vector<std::pair<CellID::Type, Cell>> rows;
+      std::string line;
+      while(std::getline(input, line))
+      {
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        CellID::Type id;
+        Cell cell;
+        if(fields >> id >> cell.x >> cell.y >> cell.z >> cell.dx >> cell.dy >> cell.dz) rows.emplace_back(id, cell);
+      }
+
+      for(const auto& row : rows)
+      {
+        auto& grid = fGrids[CellID::Subsystem(row.first)];
+        grid.nX = std::max(grid.nX, CellID::X(row.first) + 1);
+        grid.nY = std::max(grid.nY, CellID::Y(row.first) + 1);
+        grid.nLayers = std::max(grid.nLayers, CellID::Layer(row.first) + 1);
+      }
+      for(auto& grid : fGrids)
+      {
+        grid.cells.resize(std::size_t(grid.nX)*grid.nY*grid.nLayers);
+        grid.present.resize(grid.cells.size(), false);
+      }
+      for(const auto& row : rows)
+      {
+        auto& grid = fGrids[CellID::Subsystem(row.first)];
+        auto index = grid.Index(row.first);
+        grid.cells[index] = row.second;
+        grid.present[index] = true;
+      }
+      fSize = rows.size();
+    }
+
+    // Cell of a CellID of the output, nullptr if it is not in the table
+    const Cell* Find(CellID::Type id) const
+    {
+      if(CellID::Fiber(id) != 0) return nullptr;
+      const auto& grid = fGrids[CellID::Subsystem(id)];
+      if(CellID::X(id) >= grid.nX || CellID::Y(id) >= grid.nY || CellID::Layer(id) >= grid.nLayers) return nullptr;
+      auto index = grid.Index(id);
+      return grid.present[index] ? &grid.cells[index] : nullptr;
+    }
+
+    // Number of cells in the table, 0 if it could not be read
+    std::size_t Size() const { return fSize; }
+
+  private:
+    struct Grid
+    {
+      int nX = 0, nY = 0, nLayers = 0;
+      std::vector<Cell> cells;
+      std::vector<bool> present;
+
+      std::size_t Index(CellID::Type id) const
+      {
+        return (std::size_t(CellID::X(id))*nY + CellID::Y(id))*nLayers + CellID::Layer(id);
+      }
+    };
+
+    Grid fGrids[1 << CellID::kSubsystemBits]; // by subsystem
+    std::size_t fSize = 0;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
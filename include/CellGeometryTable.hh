@@ -0,0 +1,29 @@
+/// \file CellGeometryTable.hh
+/// \brief Definition of the CellGeometryTable class
+
+#ifndef CellGeometryTable_h
+#define CellGeometryTable_h 1
+
+#include "globals.hh"
+
+/// Writer of the cell geometry table read by CellGeometry.
+///
+/// Write() walks the closed geometry and writes one line per cell with its
+/// CellID, centre and half sizes in mm: the ECal blocks, the scintillator
+/// plates of every HCal tower and layer, and the cells of ReadoutWorld if it
+/// exists. Positions are taken from the placements, so clearance gaps, glue
+/// and the tower variants need not be re-derived in the analysis.
+///
+/// The master RunAction writes the table next to the output file of every
+/// run, as <output>_cells.txt.
+
+class CellGeometryTable
+{
+  public:
+    // Returns the number of cells written
+    static G4int Write(const G4String& fileName);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
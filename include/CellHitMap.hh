@@ -0,0 +1,99 @@
+/// \file CellHitMap.hh
+/// \brief Open-addressing map from cell IDs to hit indices
+
+#ifndef CellHitMap_h
+#define CellHitMap_h 1
+
+#include "globals.hh"
+#include "CellID.hh"
+
+#include <vector>
+
+/// Index of the hit of each touched cell in a hits collection, for the
+/// CalorimeterSD of one thread.
+///
+/// The slots are a power-of-two array probed linearly from the Fibonacci hash
+/// of the CellID. The array is allocated once and only grows (at half load),
+/// so an event does not allocate once the map has seen a large shower. The
+/// used slots are listed, and Clear() resets only those: the cost per event
+/// follows the number of touched cells, not the number of cells, which
+/// matters for fiber-level ECal readout with millions of cells.
+
+class CellHitMap
+{
+  public:
+    explicit CellHitMap(std::size_t capacity = 4096) { Reserve(capacity); }
+
+    // Index of the hit of the cell, -1 if the cell has none
+    G4int Find(CellID::Type id) const
+    {
+      for(std::size_t slot = Hash(id); ; slot = (slot + 1) & fMask)
+      {
+        const auto& entry = fSlots[slot];
+        if(entry.index < 0 || entry.id == id) return entry.index;
+      }
+    }
+
+    // Add a cell that is not in the map
+    void Insert(CellID::Type id, G4int index)
+    {
+      if(2*(fUsed.size() + 1) > fSlots.size()) Reserve(2*fSlots.size());
+      Place(id, index);
+    }
+
+    void Clear()
+    {
+      for(auto slot : fUsed) fSlots[slot].index = -1;
+      fUsed.clear();
+    }
+
+    // Grow to at least the given number of slots, keeping the entries
+    void Reserve(std::size_t capacity)
+    {
+      std::size_t size = 16;
+      G4int bits = 4;
+      while(size < capacity) { size <<= 1; bits++; }
+      if(size <= fSlots.size()) return;
+
+      std::vector<Slot> entries;
+      for(auto slot : fUsed) entries.push_back(fSlots[slot]);
+      fSlots.assign(size, Slot());
+      fMask = size - 1;
+      fShift = 64 - bits;
+      fUsed.clear();
+      fUsed.reserve(size/2);
+      for(const auto& entry : entries) Place(entry.id, entry.index);
+    }
+
+    std::size_t Size() const { return fUsed.size(); }
+
+  private:
+    struct Slot
+    {
+      CellID::Type id = 0;
+      G4int index = -1; // -1 for a free slot
+    };
+
+    std::size_t Hash(CellID::Type id) const
+    {
+      return std::size_t((id*0x9E3779B97F4A7C15ULL) >> fShift);
+    }
+
+    void Place(CellID::Type id, G4int index)
+    {
+      std::size_t slot = Hash(id);
+      while(fSlots[slot].index >= 0) slot = (slot + 1) & fMask;
+      fSlots[slot].id = id;
+      fSlots[slot].index = index;
+      fUsed.push_back(slot);
+    }
+
+    std::vector<Slot> fSlots;
+    std::vector<std::size_t> fUsed; // occupied slots
+    std::size_t fMask = 0;
+    G4int fShift = 64;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,67 @@
+/// \file CellID.hh
+/// \brief Bit-packed calorimeter cell identifiers
+
+#ifndef CellID_h
+#define CellID_h 1
+
+#include <cstdint>
+
+/// 64-bit cell identifier shared by the geometry, the SDs and the output.
+///
+///   bits  0-13  fiber group + 1 (0 if the cell is not segmented in fibers)
+///   bits 14-23  layer (0 if the cell is not segmented in layers)
+///   bits 24-33  y index j of the tower or block
+///   bits 34-43  x index i of the tower or block
+///   bits 44-47  subsystem
+///
+/// IDs use 48 bits, so they are exact in a double ntuple column.
+///
+/// HCal towers and ECal blocks are placed with copy number CopyNumber(i, j),
+/// which the SD decodes with CopyX() and CopyY().
+///
+/// Only standard C++ is used, so the header can be included by ROOT macros
+/// together with CellGeometry.hh.
+
+namespace CellID
+{
+  typedef std::uint64_t Type;
+
+  // Readout cells of the parallel world (ReadoutWorld) have their own subsystems
+  enum Subsystem { kECal = 1, kHCal = 2, kECalReadout = 3, kHCalReadout = 4 };
+
+  const int kFiberBits = 14;
+  const int kLayerBits = 10;
+  const int kYBits = 10;
+  const int kXBits = 10;
+  const int kSubsystemBits = 4;
+
+  const int kLayerShift = kFiberBits;
+  const int kYShift = kLayerShift + kLayerBits;
+  const int kXShift = kYShift + kYBits;
+  const int kSubsystemShift = kXShift + kXBits;
+
+  const int kMaxXY = 1 << kXBits; // towers or blocks per side
+  const int kMaxLayers = 1 << kLayerBits;
+  const int kMaxFibers = 1 << kFiberBits;
+
+  inline Type Encode(int subsystem, int x, int y, int layer = 0, int fiber = 0)
+  {
+    return (Type(subsystem) << kSubsystemShift) | (Type(x) << kXShift) | (Type(y) << kYShift)
+         | (Type(layer) << kLayerShift) | Type(fiber);
+  }
+
+  inline int Subsystem(Type id) { return int(id >> kSubsystemShift) & ((1 << kSubsystemBits) - 1); }
+  inline int X(Type id) { return int(id >> kXShift) & (kMaxXY - 1); }
+  inline int Y(Type id) { return int(id >> kYShift) & (kMaxXY - 1); }
+  inline int Layer(Type id) { return int(id >> kLayerShift) & (kMaxLayers - 1); }
+  inline int Fiber(Type id) { return int(id) & (kMaxFibers - 1); }
+
+  // Copy numbers of tower and block placements
+  inline int CopyNumber(int x, int y) { return (x << kYBits) | y; }
+  inline int CopyX(int copyNo) { return copyNo >> kYBits; }
+  inline int CopyY(int copyNo) { return copyNo & (kMaxXY - 1); }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,63 @@
+/// \file ConstructionProfiler.hh
+/// \brief Definition of the ConstructionProfiler class
+
+#ifndef ConstructionProfiler_h
+#define ConstructionProfiler_h 1
+
+#include "globals.hh"
+#include "G4Timer.hh"
+
+#include <vector>
+
+/// Timing and memory of the geometry construction stages, and an inventory
+/// of the geometry stores.
+///
+/// DetectorConstruction opens a stage with Begin(), which closes the previous
+/// one, and closes the last one with End(). Each stage records its wall time
+/// and the change of the resident set size (from /proc/self/statm).
+///
+/// Report() is called by the master RunAction at the start of the first run
+/// after a construction, when the geometry is closed. It prints the stages
+/// and counts of solids, logical and physical volumes, daughters per mother
+/// and the smart voxels of every mother. With voxel timing enabled, the voxels
+/// of each mother are built once more to time them. If a file name is set the
+/// same information is written as JSON.
+
+class ConstructionProfiler
+{
+  public:
+    ConstructionProfiler();
+    ~ConstructionProfiler();
+
+    void Reset();
+    void Begin(const G4String& stage);
+    void End();
+
+    void Report();
+
+    void SetReportFile(const G4String& fileName) { fReportFile = fileName; }
+    void SetVoxelTiming(G4bool flag) { fVoxelTiming = flag; }
+
+    // Resident set size of the process in bytes, 0 if unknown
+    static G4double GetResidentMemory();
+
+  private:
+    struct Stage
+    {
+      G4String name;
+      G4double time;
+      G4double memoryBefore;
+      G4double memoryAfter;
+    };
+
+    std::vector<Stage> fStages;
+    G4Timer fTimer;
+    G4bool fRunning;
+    G4bool fReported;
+    G4String fReportFile;
+    G4bool fVoxelTiming;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
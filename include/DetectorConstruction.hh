@@ -7,9 +7,21 @@
 
 #include "G4VUserDetectorConstruction.hh"
 #include "globals.hh"
+#include "Quenching.hh"
+
+#include <map>
+#include <vector>
 
 class G4VPhysicalVolume;
+class G4LogicalVolume;
 class G4GlobalMagFieldMessenger;
+class ECalLatticeNavigation;
+class G4GenericMessenger;
+class ConstructionProfiler;
+class GeometryRebuild;
+class CalorimeterSD;
+class UnifiedCalorimeterSD;
+class G4VSensitiveDetector;
 
 /// Detector construction class to define materials and geometry.
 /// The calorimeter is a box made of a given number of layers. A layer consists
@@ -26,6 +38,89 @@ class G4GlobalMagFieldMessenger;
 /// are created and associated with the Absorber and Gap volumes.
 /// In addition a transverse uniform magnetic field is defined 
 /// via G4GlobalMagFieldMessenger class.
+///
+/// The ECal fibers are placed either as individual G4PVPlacements
+/// ("placement") or as one G4PVParameterised per block ("parameterised",
+/// default). The mode is selected with /athena/geometry/fiberPlacement
+/// before /run/initialize. Parameterised fibers can be navigated with the
+/// stock voxel navigation or with ECalLatticeNavigation
+/// (/athena/geometry/fiberNavigation voxel|lattice).
+///
+/// With /athena/geometry/ecalMode mixture the ECal blocks are homogenised
+/// W/scintillator without fibers, and their deposited energy is scaled by the
+/// sampling fraction. /athena/geometry/calibrateECal measures the sampling
+/// fraction from two short runs, one with fibers and one with the mixture.
+/// With ecalMode mixed only the blocks reaching within ecalDetailRadius of
+/// the beam impact point (ecalDetailX, ecalDetailY) keep their fibers, the
+/// others are mixture blocks ("ECalMixtureLogical", placed as "ECalPhysical"
+/// as well) scaled by the sampling fraction, which keeps the fiber detail in
+/// the shower core and makes the navigation of the halo cheap.
+///
+/// /athena/geometry/cacheDir enables a GDML cache of the volume tree, see
+/// GeometryCache.
+///
+/// The numbers of HCal layers, HCal towers and ECal blocks (GlobalValues),
+/// the HCal plate thicknesses and the ECal fiber radius and pitch are set with
+/// /athena/geometry/ commands. In Idle state each of them re-initialises the
+/// geometry, which is rebuilt at the next BeamOn. The number of fiber rows and
+/// columns follows from the pitch and the block size.
+///
+/// The rebuild is incremental: the volumes are not destroyed, and the HCal
+/// (tower variants and everything below them) and the ECal (block with its
+/// fibers, and the glue) are only rebuilt if one of their own parameters
+/// changed. The world is resized and its placements are redone. The kept
+/// subsystems keep their smart voxels as well (GeometryRebuild), so e.g. an
+/// HCal thickness scan neither rebuilds nor re-voxelises the ECal fibers.
+///
+/// For a full endcap the square array is trimmed to an annulus with
+/// /athena/geometry/endcapInnerRadius and endcapOuterRadius: HCal towers and
+/// 2x2 ECal block groups are only placed if they lie entirely inside it. Hits
+/// are stored per touched cell only, and /athena/geometry/sparseOutput
+/// restricts the ntuples to those cells, so the cost per event follows the
+/// shower rather than the size of the array.
+///
+/// /athena/geometry/unifiedSD replaces the CalorimeterSD of each subsystem by
+/// one UnifiedCalorimeterSD, which accumulates all calorimeter cells into flat
+/// per-thread arrays instead of hits collections.
+///
+/// /athena/geometry/ecalGranularity reads the fiber blocks out per fiber,
+/// per bundle of ecalBundleRows x ecalBundleCols fibers or per quadrant
+/// instead of per block (see CalorimeterSD).
+///
+/// /athena/geometry/fiberLightYield converts the ECal fiber deposits to
+/// photoelectrons at the back of the blocks, attenuated along the fibers
+/// (fiberAttenuationLength) and with Poisson photostatistics, without optical
+/// photon transport (see CalorimeterSD).
+///
+/// /athena/geometry/quenching selects the quenching model of a material in
+/// the calorimeter SDs (see Quenching), e.g. to compare Birks constants or
+/// Chou's second-order law. The unified SD applies the same models.
+///
+/// /athena/geometry/checkOverlaps validates the closed geometry with
+/// OverlapChecker. /athena/geometry/placementOverlapCheck enables the serial
+/// Geant4 check of every placement during construction instead.
+///
+/// /athena/geometry/scanMaterial maps the radiation and interaction lengths
+/// seen by straight rays on an (x, y, angle) grid, per volume category, with
+/// MaterialScan.
+///
+/// /athena/geometry/benchmarkNavigation and benchmarkSD time the ECal fiber
+/// navigation (NavigationBenchmark) and the ProcessHits of the calorimeter SDs
+/// (SDBenchmark) on the closed geometry.
+///
+/// The construction stages are timed by a ConstructionProfiler, reported at
+/// the first run after each construction (/athena/geometry/profileReport
+/// writes it as JSON as well).
+///
+/// The volumes are grouped in the regions "ECal" (blocks, fibers and glue),
+/// "HCalAbsorber", "HCalActive" and "Passive" (HCal WLS and steel), each with
+/// its own production cut (/athena/geometry/ecalCut, hcalAbsorberCut,
+/// hcalActiveCut and passiveCut). A cut of 0 follows /run/setCut.
+///
+/// /athena/geometry/tuneVoxels runs a few events, times the navigation of a
+/// sample of their tracks with several smartless values per mother (see
+/// VoxelTuner) and writes the fastest ones to /athena/geometry/voxelSettings.
+/// That file is applied at every later construction.
 
 class DetectorConstruction : public G4VUserDetectorConstruction
 {
@@ -35,14 +130,152 @@ class DetectorConstruction : public G4VUserDetectorConstruction
     virtual G4VPhysicalVolume* Construct();
     virtual void ConstructSDandField();
 
+    // Time the ECal fiber navigation modes on the closed geometry
+    void BenchmarkNavigation(G4int nTracks);
+
+    // Time the ProcessHits of the calorimeter SDs on the closed geometry
+    void BenchmarkSD(G4int nSteps);
+
+    // Multithreaded overlap check of the closed geometry
+    void CheckOverlaps(G4int nPoints);
+
+    // Multithreaded material-budget scan of the closed geometry
+    void ScanMaterial(G4int nBins);
+
+    // Print (and write) the construction profile once after each construction,
+    // called by the master RunAction when the geometry is closed
+    void ReportConstruction() const;
+
+    // Select "fiber", "mixture" or "mixed" ECal blocks, re-initialising the geometry when Idle
+    void SetECalMode(const G4String& mode);
+
+    // Sampling structure, re-initialising the geometry when Idle
+    void SetNumHCalLayers(G4int n);
+    void SetNumHCalTowers(G4int n);
+    void SetNumECalBlocks(G4int n);
+    void SetAbsorberPlateThickness(G4double thickness);
+    void SetActivePlateThickness(G4double thickness);
+    void SetECalFiberRadius(G4double radius);
+    void SetECalFiberXPitch(G4double pitch);
+    void SetECalFiberYPitch(G4double pitch);
+    void SetEndcapInnerRadius(G4double radius);
+    void SetEndcapOuterRadius(G4double radius);
+    void SetECalDetailX(G4double x);
+    void SetECalDetailY(G4double y);
+    void SetECalDetailRadius(G4double radius);
+    void SetECalSamplingFraction(G4double fraction);
+
+    // ECal readout cells: "block", "fiber", "bundle" of rows x cols fibers or "quadrant"
+    void SetECalGranularity(const G4String& granularity);
+    void SetECalBundleRows(G4int n);
+    void SetECalBundleCols(G4int n);
+
+    // Fiber light model of the ECal SD, off for a light yield of 0
+    void SetFiberLightYield(G4double yield);
+    void SetFiberAttenuationLength(G4double length);
+
+    // Steps deferred and quenched in batches by the CalorimeterSDs, 0 for none
+    void SetSDBatchSize(G4int size);
+
+    // Quenching model of a material in the calorimeter SDs:
+    // "material none|birks [kB]|chou kB C|table file"
+    void SetQuenching(const G4String& setting);
+
+    // One SD with flat per-cell arrays for the ECal and the HCal, re-initialising the geometry when Idle
+    void SetUnifiedSD(G4bool flag);
+
+    // Production cuts of the regions, 0 for the default cut
+    void SetECalCut(G4double cut);
+    void SetHCalAbsorberCut(G4double cut);
+    void SetHCalActiveCut(G4double cut);
+    void SetPassiveCut(G4double cut);
+
+    // Sample tracks from nEvents and tune the voxels of every mother
+    void TuneVoxels(G4int nEvents);
+
+    // Measure the sampling fraction of the mixture blocks and switch to them
+    void CalibrateECal(G4int nEvents);
+
   private:
     // methods
     void DefineMaterials();
+    void DefineCommands();
+    void GeometryHasChanged();
     G4VPhysicalVolume* DefineVolumes();
+    void SetVisAttributes();
+    void DefineRegions();
+    void SetRegionCut(const G4String& regionName, G4double cut);
+    G4bool InEndcap(G4double x, G4double y, G4double halfX, G4double halfY) const;
+
+    // Calorimeter SDs, and their configuration for the current geometry,
+    // which returns the volumes they are attached to
+    CalorimeterSD* NewHCalSD(const G4String& name, const G4String& collectionName) const;
+    CalorimeterSD* NewECalSD(const G4String& name, const G4String& collectionName) const;
+    std::vector<G4LogicalVolume*> ConfigureHCalSD(CalorimeterSD* sd) const;
+    std::vector<G4LogicalVolume*> ConfigureECalSD(CalorimeterSD* sd) const;
+    // Quenching settings of the materials, for CalorimeterSD and UnifiedCalorimeterSD
+    template<class SD> void ConfigureQuenching(SD* sd) const;
+    std::vector<G4LogicalVolume*> ConfigureUnifiedSD(UnifiedCalorimeterSD* sd) const;
+    G4int ECalBlockDepth() const;
+    // Attach an SD in place of the one the volume may carry from before a re-initialisation
+    void AttachSD(G4LogicalVolume* lv, G4VSensitiveDetector* sd);
   
     // data members
     static G4ThreadLocal G4GlobalMagFieldMessenger*  fMagFieldMessenger; // magnetic field messenger
+    static G4ThreadLocal ECalLatticeNavigation* fLatticeNavigation; // installed in the tracking navigator
+    G4GenericMessenger* fMessenger; // geometry UI commands
     G4bool  fCheckOverlaps; // option to activate checking of volumes overlaps
+    G4String fFiberPlacement; // "placement" or "parameterised"
+    G4String fFiberNavigation; // "voxel" or "lattice"
+    G4String fECalMode; // "fiber", "mixture" or "mixed"
+    G4double fECalSamplingFraction; // visible/deposited energy of the mixture blocks
+    G4String fGeometryCacheDir; // GDML cache directory, disabled if empty
+    G4double fAbsorberPlateThickness; // HCal absorber plate
+    G4double fActivePlateThickness; // HCal scintillator plate
+    G4double fECalFiberRadius; // ECal fiber radius including cladding
+    G4double fECalFiberXPitch; // Distance between fibers in a row
+    G4double fECalFiberYPitch; // Distance between fiber rows
+    G4int    fOverlapThreads; // threads of CheckOverlaps(), 0 for all cores
+    G4double fOverlapTolerance; // overlaps up to this depth are ignored
+    G4String fOverlapReport; // JSON report of CheckOverlaps()
+    G4int    fScanThreads; // threads of ScanMaterial(), 0 for all cores
+    G4double fScanHalfWidth; // half width of the ray grid
+    G4int    fScanAngles; // number of ray angles
+    G4double fScanMaxAngle; // largest ray angle
+    G4String fScanFile; // X0 and lambda maps of ScanMaterial()
+    ConstructionProfiler* fProfiler; // stages of the master construction
+    G4String fProfileReport; // JSON file of the construction profile, none if empty
+    G4bool   fProfileVoxels; // time the voxel building of every mother
+    G4double fECalCut; // production cut of the ECal region, 0 for the default
+    G4double fHCalAbsorberCut; // production cut of the HCalAbsorber region
+    G4double fHCalActiveCut; // production cut of the HCalActive region
+    G4double fPassiveCut; // production cut of the Passive region
+    G4double fEndcapInnerRadius; // beam hole, 0 for none
+    G4double fEndcapOuterRadius; // outer edge of the endcap, 0 for the full square array
+    G4String fVoxelSettings; // tuned voxel settings file, none if empty
+    G4int    fVoxelTuningTracks; // tracks sampled by TuneVoxels()
+    G4bool   fUnifiedSD; // one UnifiedCalorimeterSD instead of a CalorimeterSD per subsystem
+    G4double fECalDetailX; // beam impact point of the mixed ECal
+    G4double fECalDetailY;
+    G4double fECalDetailRadius; // mixed ECal blocks within this distance keep their fibers
+    G4String fECalGranularity; // "block", "fiber", "bundle" or "quadrant"
+    G4int    fECalBundleRows; // fiber rows per bundle
+    G4int    fECalBundleCols; // fiber columns per bundle
+    G4int    fECalFiberRows; // fiber lattice of the current blocks
+    G4int    fECalFiberCols;
+    G4double fECalFiberLength; // fiber (block) length
+    G4double fFiberLightYield; // photoelectrons per MeV at the fiber readout, 0 for no light model
+    G4double fFiberAttenuationLength;
+    G4int    fSDBatchSize; // deferred steps of the CalorimeterSDs
+    std::map<G4String, Quenching::Parameters> fQuenching; // by material name, birks < 0 for the material's
+    std::map<G4String, Quenching::Table> fQuenchingTables; // by material name
+    GeometryRebuild* fRebuild; // volumes and voxels kept by incremental rebuilds
+    G4VPhysicalVolume* fWorldPV; // world of the previous construction
+    std::vector<G4LogicalVolume*> fHCalVolumes; // tower variants, by variant index
+    std::vector<G4LogicalVolume*> fECalVolumes; // block, horizontal and vertical glue, fiber cladding and core, mixture block
+    G4String fWorldKey; // parameters of the previous construction
+    G4String fHCalKey; // parameters of the HCal volumes
+    G4String fECalKey; // parameters of the ECal volumes
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
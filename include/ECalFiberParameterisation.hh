@@ -0,0 +1,63 @@
+/// \file ECalFiberParameterisation.hh
+/// \brief Definition of the ECalFiberParameterisation class
+
+#ifndef ECalFiberParameterisation_h
+#define ECalFiberParameterisation_h 1
+
+#include "G4VPVParameterisation.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4VPhysicalVolume;
+
+/// Parameterisation of the staggered fiber lattice inside one ECal block.
+///
+/// Copy number n maps to row n/nCols and column n%nCols. Fibers in a row
+/// are placed every xPitch towards -x starting from x0, odd rows are shifted
+/// by half a pitch, and rows are placed every yPitch towards -y from y0.
+/// All fibers share the same solid and material, so only the transformation
+/// is computed.
+
+class ECalFiberParameterisation : public G4VPVParameterisation
+{
+  public:
+    ECalFiberParameterisation(G4int nRows, G4int nCols,
+                              G4double xPitch, G4double yPitch,
+                              G4double x0, G4double y0);
+    virtual ~ECalFiberParameterisation();
+
+    virtual void ComputeTransformation(const G4int copyNo,
+                                       G4VPhysicalVolume* physVol) const;
+
+    // Centre of the fiber in the given row and column, in the block frame
+    inline G4ThreeVector GetFiberPosition(G4int row, G4int col) const;
+
+    G4int GetNumberOfFibers() const { return fNRows*fNCols; }
+    G4int GetNumberOfRows() const { return fNRows; }
+    G4int GetNumberOfColumns() const { return fNCols; }
+    G4double GetXPitch() const { return fXPitch; }
+    G4double GetYPitch() const { return fYPitch; }
+    G4double GetX0() const { return fX0; }
+    G4double GetY0() const { return fY0; }
+
+  private:
+    G4int    fNRows;  // Number of fiber rows
+    G4int    fNCols;  // Number of fibers in each row
+    G4double fXPitch; // Distance between neighbouring fibers in a row
+    G4double fYPitch; // Distance between neighbouring rows
+    G4double fX0;     // x of the first fiber in even rows
+    G4double fY0;     // y of the first row
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+inline G4ThreeVector ECalFiberParameterisation::GetFiberPosition(G4int row, G4int col) const
+{
+  G4double x = fX0 - col*fXPitch;
+  if(row % 2 != 0) x -= fXPitch/2.; // Odd rows are staggered by half a pitch
+  return G4ThreeVector(x, fY0 - row*fYPitch, 0.);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,82 @@
+/// \file ECalLatticeNavigation.hh
+/// \brief Definition of the ECalLatticeNavigation class
+
+#ifndef ECalLatticeNavigation_h
+#define ECalLatticeNavigation_h 1
+
+#include "G4VExternalNavigation.hh"
+#include "globals.hh"
+
+class G4VPhysicalVolume;
+class G4VSolid;
+class ECalFiberParameterisation;
+
+/// Navigation inside an ECal block whose only daughter is the parameterised
+/// fiber lattice (see ECalFiberParameterisation).
+///
+/// Instead of searching the smart voxels of 3120 fibers, the candidate fiber
+/// is computed directly from the local coordinates: the nearest row from y and
+/// the nearest column of that row from x. Since the row pitch is larger than
+/// the fiber diameter, that is the only fiber that can contain the point.
+/// Steps are limited by the fibers found walking the rows crossed by the ray,
+/// safeties by the 3x3 neighbourhood of the nearest fiber. All distances are
+/// computed by the fiber and block solids themselves, as in the stock
+/// navigators, so boundaries are identical.
+///
+/// The block logical volume must be flagged with ChangeDaughtersType(kExternal)
+/// and an instance installed in the navigator with SetExternalNavigation().
+
+class ECalLatticeNavigation : public G4VExternalNavigation
+{
+  public:
+    ECalLatticeNavigation(G4VPhysicalVolume* fiberPV,
+                          const ECalFiberParameterisation* param);
+    virtual ~ECalLatticeNavigation();
+
+    virtual G4VExternalNavigation* Clone();
+
+    virtual G4bool LevelLocate(G4NavigationHistory& history,
+                               const G4VPhysicalVolume* blockedVol,
+                               const G4int blockedNum,
+                               const G4ThreeVector& globalPoint,
+                               const G4ThreeVector* globalDirection,
+                               const G4bool pLocatedOnEdge,
+                               G4ThreeVector& localPoint);
+
+    virtual G4double ComputeStep(const G4ThreeVector& localPoint,
+                                 const G4ThreeVector& localDirection,
+                                 const G4double currentProposedStepLength,
+                                 G4double& newSafety,
+                                 G4NavigationHistory& history,
+                                 G4bool& validExitNormal,
+                                 G4ThreeVector& exitNormal,
+                                 G4bool& exiting,
+                                 G4bool& entering,
+                                 G4VPhysicalVolume* (*pBlockedPhysical),
+                                 G4int& blockedReplicaNo);
+
+    virtual G4double ComputeSafety(const G4ThreeVector& localPoint,
+                                   const G4NavigationHistory& history,
+                                   const G4double pMaxLength = DBL_MAX);
+
+    virtual void RelocateWithinVolume(G4VPhysicalVolume* motherPhysical,
+                                      const G4ThreeVector& localPoint);
+
+  private:
+    // Nearest row to y, or -1 if outside the lattice
+    G4int NearestRow(G4double y) const;
+    // Nearest column of the given row to x, or -1 if outside the lattice
+    G4int NearestColumn(G4int row, G4double x) const;
+    // Isotropic safety to the fibers around the point
+    G4double FiberSafety(const G4ThreeVector& localPoint) const;
+
+    G4VPhysicalVolume* fFiberPV;
+    const ECalFiberParameterisation* fParam;
+    const G4VSolid* fFiberSolid;
+    G4double fFiberRadius;
+    G4double fMaxSafety; // Lower bound of the distance to fibers outside the 3x3 neighbourhood
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
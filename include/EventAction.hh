@@ -14,11 +14,12 @@
 /// Event action class
 
 class DetectorConstruction;
+class RunAction;
 
 class EventAction : public G4UserEventAction
 {
 public:
-  EventAction();
+  EventAction(RunAction* runAction);
   virtual ~EventAction();
 
   virtual void  BeginOfEventAction(const G4Event* event);
@@ -29,7 +30,13 @@ private:
   CalorHitsCollection* GetHitsCollection(G4int hcID,
                                             const G4Event* event) const;
   void PrintEventStatistics(G4double ECalEdep, G4double gapEdep) const;
-  
+
+  // data members
+  RunAction* fRunAction; // accumulates the ECal energy for the calibration
+  G4int fHCalHCID; // HCal hits collection ID, looked up on the first event
+  G4int fECalHCID; // ECal hits collection ID, looked up on the first event
+  G4int fECalReadoutHCID; // readout cells of ReadoutWorld
+  G4int fHCalReadoutHCID;
 };
                      
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
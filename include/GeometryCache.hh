@@ -0,0 +1,49 @@
+/// \file GeometryCache.hh
+/// \brief Definition of the GeometryCache class
+
+#ifndef GeometryCache_h
+#define GeometryCache_h 1
+
+#include "globals.hh"
+
+#include <sstream>
+
+class G4VPhysicalVolume;
+
+/// GDML cache of the constructed geometry.
+///
+/// Every geometry parameter is added to a key, and the file name in the cache
+/// directory is built from the 64-bit FNV-1a hash of that key, so a change of
+/// any parameter selects a different file. Save() writes to a temporary file
+/// unique to the process and renames it into place, so jobs starting at the
+/// same time never read a partially written file.
+///
+/// The cache is disabled when the directory is empty or when Geant4 is built
+/// without GDML (G4LIB_USE_GDML not defined). GDML does not store Birks
+/// constants, visualisation attributes, parameterisations or the navigation
+/// type of the daughters, so DetectorConstruction restores them after Load().
+
+class GeometryCache
+{
+  public:
+    GeometryCache(const G4String& directory);
+    ~GeometryCache();
+
+    void AddParameter(const G4String& name, G4double value);
+    void AddParameter(const G4String& name, const G4String& value);
+
+    G4bool IsEnabled() const;
+    G4String GetFileName() const;
+
+    // Returns the world volume read from the cache, or nullptr if there is no cache file
+    G4VPhysicalVolume* Load() const;
+    void Save(G4VPhysicalVolume* worldPV) const;
+
+  private:
+    G4String fDirectory;
+    std::ostringstream fKey;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
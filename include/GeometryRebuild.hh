@@ -0,0 +1,59 @@
+/// \file GeometryRebuild.hh
+/// \brief Definition of the GeometryRebuild class
+
+#ifndef GeometryRebuild_h
+#define GeometryRebuild_h 1
+
+#include "G4VStateDependent.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class G4LogicalVolume;
+
+/// Support for incremental geometry rebuilds, where the volumes of unchanged
+/// subsystems survive a re-initialisation (ReinitializeGeometry(false)).
+///
+/// DeleteTrees() deletes a subsystem: its logical volumes and everything
+/// below them, i.e. the daughter placements, parameterisations, solids and
+/// smart voxels. The placements of the given volumes in their mother are left
+/// to the caller.
+///
+/// G4GeometryManager deletes and rebuilds the voxels of every volume in the
+/// logical-volume store when the run manager closes the geometry again.
+/// KeepVoxels() protects the given subtrees from this: when the next run
+/// initialisation starts (Idle -> Init, after the construction and the SD
+/// assignment, which look volumes up by name) their logical volumes are taken
+/// out of the store, and they are put back once the geometry is closed. Their
+/// voxels are thus reused as they are.
+
+class GeometryRebuild : public G4VStateDependent
+{
+  public:
+    GeometryRebuild();
+    virtual ~GeometryRebuild();
+
+    static void DeleteTrees(const std::vector<G4LogicalVolume*>& volumes);
+
+    // Put detached volumes back and forget the kept ones, at the start of every construction
+    void Reset();
+
+    // Keep the voxels of the given volumes and of all their descendants when
+    // the geometry is closed at the next BeamOn, called during the construction
+    void KeepVoxels(const std::vector<G4LogicalVolume*>& volumes);
+
+    virtual G4bool Notify(G4ApplicationState requestedState);
+
+  private:
+    enum EStage { kNone, kConstructing, kConstructed, kDetached };
+
+    // The given volumes and their descendants, each once
+    static std::vector<G4LogicalVolume*> CollectTrees(const std::vector<G4LogicalVolume*>& volumes);
+
+    EStage fStage;
+    std::vector<G4LogicalVolume*> fKept; // volumes whose voxels are kept
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -10,8 +10,18 @@
 
 namespace GlobalValues
 {
-    extern const G4int NumHCalLayers; // Number of total layers in HCal
-    extern const G4int NumHCalTowers; // One-dimensional number of towers. Current is 6x6, so this = 6
-    extern const G4int NumECalBlocks; // One-dimensional number of blocks. Current is 8x8, so this = 8
+    // Set between runs through /athena/geometry/, see DetectorConstruction
+    extern G4int NumHCalLayers; // Number of total layers in HCal
+    extern G4int NumHCalTowers; // One-dimensional number of towers. Default is 6x6, so this = 6
+    extern G4int NumECalBlocks; // One-dimensional number of blocks. Default is 8x8, so this = 8
+    extern G4bool ECalCalibrationRun; // True while DetectorConstruction::CalibrateECal() runs events, no output is written
+    extern G4bool SparseOutput; // Only touched cells are written to the ntuples, see EventAction
+
+    // Integration windows of the electronics, NumTimeWindows windows of TimeWindowWidth
+    // from TimeWindowStart (global time). Deposits outside them are not scored, see CalorimeterSD.
+    extern G4int NumTimeWindows; // 0 scores every deposit, whatever its time
+    extern G4double TimeWindowStart;
+    extern G4double TimeWindowWidth;
+    extern G4bool KillLateTracks; // Kill tracks past the last window, see SteppingAction and StackingAction
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+/// \file MaterialScan.hh
+/// \brief Definition of the MaterialScan class
+
+#ifndef MaterialScan_h
+#define MaterialScan_h 1
+
+#include "globals.hh"
+
+class G4VPhysicalVolume;
+
+/// Multithreaded material-budget scan of the closed geometry.
+///
+/// Straight rays are cast through the mass geometry with one G4Navigator per
+/// thread, without particles, physics or events. The rays cross the front face
+/// of the detector (lowest z of the world daughters) on an nBins x nBins grid
+/// of bin centres in |x|, |y| < halfWidth, tilted towards +y by nAngles angles
+/// from 0 to maxAngle (one angle of 0 for nAngles = 1), like the tilted beams
+/// of the macros. Each ray starts at the -z edge of the world and ends when it
+/// leaves the world.
+///
+/// Along each ray the path length over the radiation length (X0) and over the
+/// nuclear interaction length (lambda) of the material is summed per volume
+/// category: ECal absorber (blocks), ECal fibers (core and cladding), ECal
+/// glue, HCal absorber, HCal active, HCal WLS, HCal steel and other.
+///
+/// The maps are written as a text table with one row per ray, whose first line
+/// is the branch descriptor of TTree::ReadFile:
+///
+///   TTree t; t.ReadFile("material_scan.txt");
+///   t.Draw("y:x", "X0*(angle==0)", "colz");
+///
+/// Threads other than the calling one get their own copy of the thread-local
+/// geometry data (G4WorkerThread), so that parameterised and replicated
+/// volumes can be navigated concurrently. ECal blocks with lattice navigation
+/// use an ECalLatticeNavigation per thread.
+
+class MaterialScan
+{
+  public:
+    static void Run(G4VPhysicalVolume* worldPV, G4int nBins, G4double halfWidth,
+                    G4int nAngles, G4double maxAngle, G4int nThreads, const G4String& fileName);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,26 @@
+/// \file NavigationBenchmark.hh
+/// \brief Definition of the NavigationBenchmark class
+
+#ifndef NavigationBenchmark_h
+#define NavigationBenchmark_h 1
+
+#include "globals.hh"
+
+/// Navigation micro-benchmarks run on the closed geometry of the master.
+///
+/// RunECalLattice() starts tracks at random points inside the ECal blocks
+/// with isotropic directions and transports them geometrically (ComputeStep
+/// followed by a relative LocateGlobalPointAndSetup) until they leave the
+/// block, once with the stock voxel navigation of the parameterised fibers
+/// and once with ECalLatticeNavigation. It prints the time per step of both
+/// and checks that both modes give the same number of steps and path length.
+
+class NavigationBenchmark
+{
+  public:
+    static void RunECalLattice(G4int nTracks, G4int maxSteps = 1000);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,37 @@
+/// \file OverlapChecker.hh
+/// \brief Definition of the OverlapChecker class
+
+#ifndef OverlapChecker_h
+#define OverlapChecker_h 1
+
+#include "globals.hh"
+
+class G4VPhysicalVolume;
+
+/// Multithreaded overlap check of the closed geometry.
+///
+/// Overlaps are a property of a logical volume and its daughters, so every
+/// logical volume with daughters (a "template") is checked once in its own
+/// frame, however often it is placed. The daughter placements, including every
+/// copy of a parameterised volume, are flattened on the calling thread into
+/// solids and transforms, so the worker threads only call const G4VSolid
+/// methods. Replicas fill their mother by construction and are not checked.
+///
+/// Points are generated on the surface of each daughter, nPoints in total,
+/// shared among the daughters in proportion to their volume with at least
+/// minPoints each. A point outside the mother or inside a sister by more than
+/// the tolerance is an overlap. Results are grouped by template and by pair of
+/// logical volumes, printed and written as JSON to reportFile.
+///
+/// Parameterisations are assumed not to change the dimensions of the solid.
+
+class OverlapChecker
+{
+  public:
+    static void Run(G4VPhysicalVolume* worldPV, G4long nPoints, G4int nThreads,
+                    G4double tolerance, const G4String& reportFile, G4int minPoints = 10);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
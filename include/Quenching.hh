@@ -0,0 +1,122 @@
+/// \file Quenching.hh
+/// \brief Quenching models of the scintillator response
+
+#ifndef Quenching_h
+#define Quenching_h 1
+
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <vector>
+
+/// Fraction of the deposited energy seen as light by a scintillator, as a
+/// function of the stopping power dE/dx of the step (edep / step length, 0
+/// for neutral steps):
+/// - None:      1
+/// - Birks:     1 / (1 + kB dE/dx)
+/// - Chou:      1 / (1 + kB dE/dx + C (dE/dx)^2), Birks' law to second order
+/// - Tabulated: linear interpolation in a table at equal steps of dE/dx from
+///              0, constant beyond the last entry
+///
+/// Each model is a policy with a static inline Factor() of plain constants.
+/// Apply<Policy>() is the loop over a batch of steps of one model: the
+/// per-step constants kB and C come in separate arrays, the table is shared
+/// by the batch, and the energy scale and light yield are applied in the
+/// same loop, so it is compiled without branches or indirect calls and can
+/// be vectorised (see CalorimeterSD::SetBatchSize()).
+///
+/// Steps processed one at a time go through the Function of their model,
+/// which Select() resolves once per volume when the SD caches the volume.
+/// Its body is branch-free, but each step costs an indirect call, and only
+/// the batched mode runs the vectorisable loop.
+
+namespace Quenching
+{
+  enum Model { kNone, kBirks, kChou, kTabulated, kNofModels };
+
+  struct Table
+  {
+    G4double dEdxStep = 1.*CLHEP::MeV/CLHEP::mm; // dE/dx between the entries
+    std::vector<G4double> factor; // at least 2 entries, the first at dE/dx = 0
+  };
+
+  // Model of a material and its constants
+  struct Parameters
+  {
+    Model model = kNone;
+    G4double birks = 0.; // kB
+    G4double chou = 0.; // C
+    const Table* table = nullptr;
+  };
+
+  struct None
+  {
+    static G4double Factor(G4double, G4double, const Table*, G4double) { return 1.; }
+  };
+
+  struct Birks
+  {
+    static G4double Factor(G4double birks, G4double, const Table*, G4double dEdx) { return 1./(1. + birks*dEdx); }
+  };
+
+  struct Chou
+  {
+    static G4double Factor(G4double birks, G4double chou, const Table*, G4double dEdx)
+    {
+      return 1./(1. + (birks + chou*dEdx)*dEdx);
+    }
+  };
+
+  struct Tabulated
+  {
+    static G4double Factor(G4double, G4double, const Table* table, G4double dEdx)
+    {
+      const auto& factor = table->factor;
+      G4double position = std::min(dEdx/table->dEdxStep, G4double(factor.size() - 1));
+      std::size_t bin = std::min(std::size_t(position), factor.size() - 2);
+      G4double fraction = position - bin;
+      return (1. - fraction)*factor[bin] + fraction*factor[bin + 1];
+    }
+  };
+
+  // Scaled deposits and photoelectrons of n steps of one model, sharing one table.
+  // The outputs must not overlap the inputs.
+  template<class Policy>
+  inline void Apply(G4int n, const G4double* edep, const G4double* dEdx,
+                    const G4double* birks, const G4double* chou, const Table* table,
+                    const G4double* scale, const G4double* light,
+                    G4double* __restrict deposit, G4double* __restrict npe)
+  {
+    for(G4int k = 0; k < n; k++)
+    {
+      G4double quenched = edep[k]*Policy::Factor(birks[k], chou[k], table, dEdx[k]);
+      deposit[k] = quenched*scale[k];
+      npe[k] = quenched*light[k];
+    }
+  }
+
+  // Quenched energy of a single step
+  typedef G4double (*Function)(const Parameters&, G4double edep, G4double dEdx);
+
+  template<class Policy>
+  inline G4double Quench(const Parameters& p, G4double edep, G4double dEdx)
+  {
+    return edep*Policy::Factor(p.birks, p.chou, p.table, dEdx);
+  }
+
+  inline Function Select(Model model)
+  {
+    switch(model)
+    {
+      case kBirks:     return &Quench<Birks>;
+      case kChou:      return &Quench<Chou>;
+      case kTabulated: return &Quench<Tabulated>;
+      default:         return &Quench<None>;
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
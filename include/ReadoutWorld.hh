@@ -0,0 +1,71 @@
+/// \file ReadoutWorld.hh
+/// \brief Definition of the ReadoutWorld class
+
+#ifndef ReadoutWorld_h
+#define ReadoutWorld_h 1
+
+#include "G4VUserParallelWorld.hh"
+#include "globals.hh"
+
+class G4GenericMessenger;
+class G4VUserDetectorConstruction;
+class G4VModularPhysicsList;
+
+/// Parallel world holding the readout cells, independent of the mass geometry.
+///
+/// Construct() places one readout envelope on every ECal block and HCal tower
+/// of the mass world, at the same position and with the same copy number
+/// CellID::CopyNumber(i, j), so it follows any geometry, including one read
+/// from the cache. ECal envelopes are divided into nECalSegments x
+/// nECalSegments sub-towers by two replicas, HCal envelopes into
+/// nHCalSections depth sections by one replica along z.
+///
+/// ConstructSD() attaches CalorimeterSDs "ECalReadoutSD" and "HCalReadoutSD"
+/// to the cells. They only score steps whose mass volume carries the mass SD
+/// of the same subsystem (ECal fibers or mixture blocks, HCal scintillator),
+/// with the energy scale of that SD. The mass geometry and its navigation are
+/// unchanged, only the parallel navigation of these few boxes is added.
+///
+/// The segmentation is set with /athena/readout/ecalSegments and
+/// hcalSections. In Idle state they re-initialise the geometry, the mass
+/// geometry is then read back from the cache if one is set.
+///
+/// The readout world is opt-in: both default to 0, which means no readout
+/// cells for that subsystem. The world and its G4ParallelWorldPhysics are
+/// only registered with the detector construction and the physics list given
+/// to SetRegistration() when one of them is first set above 0, which must
+/// happen before /run/initialize. A job without them has no parallel
+/// navigation and no readout SDs.
+
+class ReadoutWorld : public G4VUserParallelWorld
+{
+  public:
+    ReadoutWorld(const G4String& worldName);
+    virtual ~ReadoutWorld();
+
+    virtual void Construct();
+    virtual void ConstructSD();
+
+    // Where the world and its physics are registered once it is enabled
+    void SetRegistration(G4VUserDetectorConstruction* detector, G4VModularPhysicsList* physicsList);
+
+    // Segmentation, re-initialising the geometry when Idle, 0 for no readout cells
+    void SetECalSegments(G4int n);
+    void SetHCalSections(G4int n);
+
+  private:
+    void DefineCommands();
+    void SegmentationHasChanged();
+    void Register();
+
+    G4GenericMessenger* fMessenger; // readout UI commands
+    G4int fECalSegments; // readout cells per ECal block side
+    G4int fHCalSections; // readout depth sections per HCal tower
+    G4VUserDetectorConstruction* fDetector;
+    G4VModularPhysicsList* fPhysicsList;
+    G4bool fRegistered;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -6,11 +6,18 @@
 #define RunAction_h 1
 
 #include "G4UserRunAction.hh"
+#include "G4Accumulable.hh"
+#include "G4Timer.hh"
 #include "globals.hh"
 
 class G4Run;
 
 /// Run action class
+///
+/// Besides the ntuple output it accumulates the ECal energy over the run,
+/// which DetectorConstruction::CalibrateECal() reads back on the master.
+/// No file is opened while GlobalValues::ECalCalibrationRun is set.
+/// The master prints the event rate and resident memory of every run.
 
 class RunAction : public G4UserRunAction
 {
@@ -20,6 +27,16 @@ class RunAction : public G4UserRunAction
 
     virtual void BeginOfRunAction(const G4Run*);
     virtual void   EndOfRunAction(const G4Run*);
+
+    void AddECalEdep(G4double edep) { fECalEdep += edep; }
+
+    // Mean ECal energy per event of the last run, valid on the master after EndOfRunAction
+    G4double GetMeanECalEdep() const;
+
+  private:
+    G4Accumulable<G4double> fECalEdep;
+    G4int fNofEvents;
+    G4Timer fRunTimer;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,27 @@
+/// \file StackingAction.hh
+/// \brief Definition of the StackingAction class
+
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+
+/// Stacking action class
+///
+/// With integration windows (GlobalValues::NumTimeWindows) and
+/// GlobalValues::KillLateTracks, kills every new track created after the end
+/// of the last window, before it is stacked. SteppingAction kills the tracks
+/// that cross the end of the window while they are transported.
+
+class StackingAction : public G4UserStackingAction
+{
+  public:
+    StackingAction();
+    virtual ~StackingAction();
+
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
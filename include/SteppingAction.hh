@@ -0,0 +1,29 @@
+/// \file SteppingAction.hh
+/// \brief Definition of the SteppingAction class
+
+#ifndef SteppingAction_h
+#define SteppingAction_h 1
+
+#include "G4UserSteppingAction.hh"
+
+/// Stepping action class
+///
+/// With integration windows (GlobalValues::NumTimeWindows) and
+/// GlobalValues::KillLateTracks, kills every track whose global time has
+/// passed the end of the last window. Their deposits would not be scored, and
+/// slow neutrons thermalising in the absorbers for microseconds otherwise take
+/// a large part of the CPU time with the HP neutron models. Their late
+/// secondaries are killed by StackingAction before they are stacked.
+
+class SteppingAction : public G4UserSteppingAction
+{
+  public:
+    SteppingAction();
+    virtual ~SteppingAction();
+
+    virtual void UserSteppingAction(const G4Step* step);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,24 @@
+/// \file TrackingAction.hh
+/// \brief Definition of the TrackingAction class
+
+#ifndef TrackingAction_h
+#define TrackingAction_h 1
+
+#include "G4UserTrackingAction.hh"
+
+/// Tracking action class
+///
+/// Hands the start of every track to the VoxelTuner while it is recording.
+
+class TrackingAction : public G4UserTrackingAction
+{
+  public:
+    TrackingAction();
+    virtual ~TrackingAction();
+
+    virtual void PreUserTrackingAction(const G4Track* track);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
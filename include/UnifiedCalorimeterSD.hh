@@ -0,0 +1,117 @@
+/// \file UnifiedCalorimeterSD.hh
+/// \brief Definition of the UnifiedCalorimeterSD class
+
+#ifndef UnifiedCalorimeterSD_h
+#define UnifiedCalorimeterSD_h 1
+
+#include "G4VSensitiveDetector.hh"
+
+#include "CellID.hh"
+#include "Quenching.hh"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class G4Step;
+class G4HCofThisEvent;
+class G4LogicalVolume;
+class G4Material;
+
+/// One sensitive detector for all cells of the ECal and the HCal, selected
+/// with /athena/geometry/unifiedSD instead of the CalorimeterSD per subsystem.
+///
+/// Instead of a hits collection it accumulates into flat arrays, one entry per
+/// cell of every subsystem (structure of arrays): energy, track length and
+/// number of steps. A subsystem is a section of the arrays with its own
+/// layout, nofXY x nofXY towers (blocks) of nofLayers cells, numbered
+///   cell = offset + (i*nofXY + j)*nofLayers + layer
+/// Initialize() zeroes the arrays, and EventAction reads them with a linear
+/// scan. The SD is per thread, so are its arrays. Steps outside the
+/// integration windows (GlobalValues::NumTimeWindows) are not scored, the
+/// arrays are not split by window.
+///
+/// Each sensitive logical volume is added with its subsystem, the touchable
+/// depth of its tower (block), whose copy number is CellID::CopyNumber(i, j),
+/// the depth of its layer replica (< 0 for none) and its energy scale. These
+/// are cached with the quenching model of the material in a table indexed by
+/// the instance ID of the volume, as in CalorimeterSD. The models are set per
+/// material with SetQuenching() as for CalorimeterSD, other materials follow
+/// Birks' law with their own constant. Steps are quenched one at a time by
+/// the function of their model, resolved when the volume is cached. The SD works in the
+/// mass geometry only, the readout cells of ReadoutWorld keep their own SDs.
+/// It has no fiber light model, so the photoelectron columns stay 0.
+
+class UnifiedCalorimeterSD : public G4VSensitiveDetector
+{
+  public:
+    UnifiedCalorimeterSD(const G4String& name);
+    virtual ~UnifiedCalorimeterSD();
+
+    // methods from base class
+    virtual void   Initialize(G4HCofThisEvent* hitCollection);
+    virtual G4bool ProcessHits(G4Step* step, G4TouchableHistory* history);
+
+    // The SD is kept across geometry re-initialisations and reconfigured
+    void SetLayout(CellID::Subsystem subsystem, G4int nofXY, G4int nofLayers = 1);
+    void AddVolume(const G4LogicalVolume* volume, CellID::Subsystem subsystem,
+                   G4int cellDepth, G4int layerDepth = -1, G4double energyScale = 1.);
+    void ClearVolumes();
+
+    // Quenching model of the steps in a material, the table (if any) is copied
+    void SetQuenching(const G4Material* material, const Quenching::Parameters& parameters);
+    void ClearQuenching();
+
+    // Subsystem and energy scale of an added volume (0 and 1 otherwise)
+    G4int    GetSubsystem(const G4LogicalVolume* volume) const;
+    G4double GetEnergyScale(const G4LogicalVolume* volume) const;
+
+    // Section of a subsystem in the arrays
+    std::size_t GetOffset(CellID::Subsystem subsystem) const { return fSections[subsystem].offset; }
+    G4int GetNofXY(CellID::Subsystem subsystem) const { return fSections[subsystem].nofXY; }
+    G4int GetNofLayers(CellID::Subsystem subsystem) const { return fSections[subsystem].nofLayers; }
+    std::size_t GetNofCells(CellID::Subsystem subsystem) const;
+
+    // Arrays of this event, indexed by cell
+    const G4double* GetEdep() const { return fEdep.data(); }
+    const G4double* GetTrackLength() const { return fTrackLength.data(); }
+    const G4int*    GetNumHits() const { return fNumHits.data(); }
+
+  private:
+    struct Section
+    {
+      std::size_t offset = 0;
+      G4int nofXY = 0;
+      G4int nofLayers = 1;
+    };
+
+    // Settings of an added volume, and the quenching model of its material
+    struct VolumeRecord
+    {
+      G4bool   valid = false;
+      G4bool   sensitive = false;
+      G4int    subsystem = 0;
+      G4int    cellDepth = 0;
+      G4int    layerDepth = -1;
+      Quenching::Parameters quenching;
+      Quenching::Function quench = &Quenching::Quench<Quenching::None>;
+      G4double energyScale = 1.;
+    };
+
+    void Resize();
+    const VolumeRecord& GetRecord(const G4LogicalVolume* volume);
+
+    static const G4int kNofSubsystems = CellID::kHCalReadout + 1;
+    Section fSections[kNofSubsystems];
+    std::vector<G4double> fEdep;
+    std::vector<G4double> fTrackLength;
+    std::vector<G4int>    fNumHits;
+    std::unordered_map<const G4LogicalVolume*, VolumeRecord> fVolumes; // added volumes
+    std::vector<VolumeRecord> fVolumeTable; // by logical-volume instance ID
+    std::unordered_map<const G4Material*, Quenching::Parameters> fMaterialQuenching;
+    std::map<const G4Material*, Quenching::Table> fQuenchingTables; // referenced by fMaterialQuenching
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -0,0 +1,52 @@
+/// \file VisLevelOfDetail.hh
+/// \brief Definition of the VisLevelOfDetail class
+
+#ifndef VisLevelOfDetail_h
+#define VisLevelOfDetail_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+class G4GenericMessenger;
+
+/// Level-of-detail visualisation of the fiber ECal.
+///
+/// /athena/vis/lod builds a new scene for the current viewer from the world
+/// down to the HCal towers and ECal blocks only, which are drawn as
+/// translucent solid envelopes. The full fiber structure is added for:
+///
+/// - the blocks inside the region seen by the viewer (extent of the scene
+///   divided by the zoom factor, around the target point), as long as there
+///   are at most maxDetailedBlocks of them, i.e. when zoomed in;
+/// - the showerBlocks blocks with the most ECal energy in the events kept by
+///   the last run (/vis/scene/endOfEventAction accumulate keeps them).
+///
+/// Trajectories and hits are added to the scene as in vis.mac. Run the command
+/// again after zooming or panning, or after a new run.
+
+class VisLevelOfDetail
+{
+  public:
+    VisLevelOfDetail();
+    ~VisLevelOfDetail();
+
+    void Update();
+
+  private:
+    void DefineCommands();
+    void SetVisAttributes() const;
+
+    // Copy numbers of the blocks to draw with their fibers
+    std::vector<G4int> GetViewedBlocks() const;
+    std::vector<G4int> GetShowerBlocks() const;
+
+    G4GenericMessenger* fMessenger; // vis UI commands
+    G4int fMaxDetailedBlocks; // viewed blocks drawn in detail, none above this
+    G4int fShowerBlocks; // blocks with most energy drawn in detail
+    G4int fNofScenes; // scenes created so far, for unique names
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
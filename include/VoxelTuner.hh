@@ -0,0 +1,46 @@
+/// \file VoxelTuner.hh
+/// \brief Definition of the VoxelTuner class
+
+#ifndef VoxelTuner_h
+#define VoxelTuner_h 1
+
+#include "globals.hh"
+#include "G4ThreeVector.hh"
+
+class G4VPhysicalVolume;
+
+/// Data-driven tuning of the smart voxels of every mother logical volume.
+///
+/// While recording, TrackingAction passes the start point and direction of
+/// every track of a real run; a uniform sample of at most maxTracks of them
+/// is kept (reservoir sampling, any thread).
+///
+/// Run() transports the sampled tracks geometrically through the closed
+/// geometry of the master and tries a few settings for every mother with
+/// voxels, one mother after the other: no voxels (SetOptimisation(false),
+/// not for replicated daughters) and smartless values from 0.5 to 8. The
+/// voxels of that mother are rebuilt for each setting and the fastest one is
+/// kept. The settings are printed and written to settingsFile, with one line
+/// "logical_volume optimise smartless" per mother.
+///
+/// ApplySettings() reads such a file and sets the logical volumes of the
+/// store by name, before the geometry is closed.
+
+class VoxelTuner
+{
+  public:
+    static void StartRecording(G4int maxTracks);
+    static void StopRecording();
+    static G4bool IsRecording();
+    static void RecordTrack(const G4ThreeVector& position, const G4ThreeVector& direction);
+
+    static void Run(G4VPhysicalVolume* worldPV, const G4String& settingsFile,
+                    G4int nRepetitions = 3, G4int maxSteps = 10000);
+
+    // Returns the number of logical volumes set
+    static G4int ApplySettings(const G4String& settingsFile);
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -8,6 +8,8 @@
 #include "G4Colour.hh"
 #include "G4VisAttributes.hh"
 
+#include <algorithm>
+
 G4ThreadLocal G4Allocator<CalorHit>* CalorHitAllocator = 0;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -16,8 +18,12 @@ CalorHit::CalorHit()
  : G4VHit(),
    fEdep(0.),
    fTrackLength(0.),
-   fNumHits(0)
-{}
+   fNumHits(0),
+   fCellID(0),
+   fPhotoelectrons(0.)
+{
+  std::fill(fWindowEdep, fWindowEdep + kMaxTimeWindows, 0.);
+}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -30,6 +36,10 @@ CalorHit::CalorHit(const CalorHit& right)
 {
   fEdep        = right.fEdep;
   fTrackLength = right.fTrackLength;
+  fNumHits     = right.fNumHits;
+  fCellID      = right.fCellID;
+  fPhotoelectrons = right.fPhotoelectrons;
+  std::copy(right.fWindowEdep, right.fWindowEdep + kMaxTimeWindows, fWindowEdep);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -38,6 +48,10 @@ const CalorHit& CalorHit::operator=(const CalorHit& right)
 {
   fEdep        = right.fEdep;
   fTrackLength = right.fTrackLength;
+  fNumHits     = right.fNumHits;
+  fCellID      = right.fCellID;
+  fPhotoelectrons = right.fPhotoelectrons;
+  std::copy(right.fWindowEdep, right.fWindowEdep + kMaxTimeWindows, fWindowEdep);
 
   return *this;
 }
@@ -7,21 +7,238 @@
 #include "G4Step.hh"
 #include "G4ThreeVector.hh"
 #include "G4SDManager.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
 #include "G4ios.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4NavigationHistory.hh"
+#include "G4Poisson.hh"
 #include "DetectorConstruction.hh"
+#include "GlobalValues.hh"
+
+#include <algorithm>
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 CalorimeterSD::CalorimeterSD(
                             const G4String& name, 
                             const G4String& hitsCollectionName,
-                            G4int nofCells)
+                            CellID::Subsystem subsystem,
+                            G4int nofXY,
+                            G4int cellDepth,
+                            G4int layerDepth,
+                            G4int nofLayers)
  : G4VSensitiveDetector(name),
    fHitsCollection(nullptr),
-   fNofCells(nofCells)
+   fSubsystem(subsystem),
+   fNofXY(0),
+   fNofCells(0),
+   fCellDepth(cellDepth),
+   fLayerDepth(layerDepth),
+   fNofLayers(1),
+   fEnergyScale(1.),
+   fSubdivision(1),
+   fSubXDepth(0),
+   fSubYDepth(0),
+   fNofFiberGroups(0),
+   fLightYield(0.),
+   fFiberHalfLength(0.),
+   fAttenuationStep(0.),
+   fBatchSize(0),
+   fUseVolumeTable(true)
 {
   collectionName.insert(hitsCollectionName);
+  SetLayout(nofXY, nofLayers);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetLayout(G4int nofXY, G4int nofLayers)
+{
+  fNofXY = nofXY;
+  fNofLayers = nofLayers;
+  fNofCells = nofXY*nofXY*nofLayers;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetSubdivision(G4int n, G4int subXDepth, G4int subYDepth)
+{
+  fSubdivision = n;
+  fSubXDepth = subXDepth;
+  fSubYDepth = subYDepth;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetCellDepth(const G4LogicalVolume* volume, G4int cellDepth)
+{
+  fVolumeCellDepths[volume] = cellDepth;
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetEnergyScale(const G4LogicalVolume* massVolume, G4double scale)
+{
+  fVolumeEnergyScales[massVolume] = scale;
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetFiberDepth(const G4LogicalVolume* volume, G4int fiberDepth)
+{
+  fVolumeFiberDepths[volume] = fiberDepth;
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetOpticalVolume(const G4LogicalVolume* volume)
+{
+  fOpticalVolumes.insert(volume);
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetFiberResponse(G4double lightYield, G4double fiberLength, const std::vector<G4double>& attenuation)
+{
+  if ( lightYield > 0. && attenuation.size() < 2 ) {
+    G4ExceptionDescription msg;
+    msg << "The fiber attenuation table needs at least 2 entries, got " << attenuation.size();
+    G4Exception("CalorimeterSD::SetFiberResponse()",
+      "MyCode0023", FatalException, msg);
+  }
+  fLightYield = lightYield;
+  fFiberHalfLength = fiberLength/2.;
+  fAttenuation = attenuation;
+  fAttenuationStep = ( attenuation.size() > 1 ) ? fiberLength/(attenuation.size() - 1) : 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double CalorimeterSD::GetAttenuation(G4double distance) const
+{
+  G4double position = std::max(0., std::min(distance/fAttenuationStep, G4double(fAttenuation.size() - 1)));
+  std::size_t bin = std::min(std::size_t(position), fAttenuation.size() - 2);
+  G4double fraction = position - bin;
+  return (1. - fraction)*fAttenuation[bin] + fraction*fAttenuation[bin + 1];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetFiberGroups(G4int nofRows, G4int nofCols, G4int rowsPerGroup, G4int colsPerGroup)
+{
+  fFiberGroup.clear();
+  fNofFiberGroups = 0;
+  if ( rowsPerGroup <= 0 || colsPerGroup <= 0 ) return;
+
+  G4int nofGroupCols = (nofCols + colsPerGroup - 1)/colsPerGroup;
+  fNofFiberGroups = (nofRows + rowsPerGroup - 1)/rowsPerGroup*nofGroupCols;
+  // The CellID stores the group + 1
+  if ( fNofFiberGroups + 1 >= CellID::kMaxFibers ) {
+    G4ExceptionDescription msg;
+    msg << fNofFiberGroups << " fiber groups per block do not fit in the "
+        << CellID::kFiberBits << " fiber bits of the CellID";
+    G4Exception("CalorimeterSD::SetFiberGroups()",
+      "MyCode0023", FatalException, msg);
+  }
+  fFiberGroup.resize(std::size_t(nofRows)*nofCols);
+  for ( G4int row = 0; row < nofRows; row++ )
+    for ( G4int col = 0; col < nofCols; col++ )
+      fFiberGroup[row*nofCols + col] = (row/rowsPerGroup)*nofGroupCols + col/colsPerGroup;
+
+  // Fine cells touch many more hits per event, start with room for them
+  fHitIndex.Reserve(1 << 14);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetQuenching(const G4Material* material, const Quenching::Parameters& parameters)
+{
+  auto& quenching = fMaterialQuenching[material];
+  quenching = parameters;
+  if ( parameters.model == Quenching::kTabulated ) {
+    if ( ! parameters.table || parameters.table->factor.size() < 2 ) {
+      G4ExceptionDescription msg;
+      msg << "The quenching table of " << material->GetName() << " needs at least 2 entries";
+      G4Exception("CalorimeterSD::SetQuenching()",
+        "MyCode0023", FatalException, msg);
+    }
+    fQuenchingTables[material] = *parameters.table;
+    quenching.table = &fQuenchingTables[material];
+  }
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::ClearQuenching()
+{
+  fBatches[Quenching::kTabulated].table = nullptr;
+  fMaterialQuenching.clear();
+  fQuenchingTables.clear();
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::ClearVolumeSettings()
+{
+  fVolumeCellDepths.clear();
+  fVolumeFiberDepths.clear();
+  fOpticalVolumes.clear();
+  fVolumeEnergyScales.clear();
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double CalorimeterSD::GetEnergyScale(const G4LogicalVolume* massVolume) const
+{
+  auto scale = fVolumeEnergyScales.find(massVolume);
+  return ( scale != fVolumeEnergyScales.end() ) ? scale->second : fEnergyScale;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CalorimeterSD::VolumeRecord CalorimeterSD::MakeRecord(const G4LogicalVolume* volume) const
+{
+  VolumeRecord record;
+  record.valid = true;
+  record.scored = fMassVolumes.empty()
+    || std::find(fMassVolumes.begin(), fMassVolumes.end(), volume) != fMassVolumes.end();
+  auto depth = fVolumeCellDepths.find(volume);
+  record.cellDepth = ( depth != fVolumeCellDepths.end() ) ? depth->second : fCellDepth;
+  auto fiberDepth = fVolumeFiberDepths.find(volume);
+  record.fiberDepth = ( fiberDepth != fVolumeFiberDepths.end() ) ? fiberDepth->second : -1;
+  record.optical = fOpticalVolumes.count(volume) > 0;
+  auto material = volume->GetMaterial();
+  auto quenching = fMaterialQuenching.find(material);
+  if ( quenching != fMaterialQuenching.end() ) {
+    record.quenching = quenching->second;
+  }
+  else {
+    record.quenching.birks = material->GetIonisation()->GetBirksConstant();
+    record.quenching.model = ( record.quenching.birks > 0. ) ? Quenching::kBirks : Quenching::kNone;
+  }
+  record.quench = Quenching::Select(record.quenching.model);
+  record.energyScale = GetEnergyScale(volume);
+  return record;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const CalorimeterSD::VolumeRecord& CalorimeterSD::GetRecord(const G4LogicalVolume* volume)
+{
+  // Instance IDs are not reused, volumes of a rebuilt geometry get new entries
+  std::size_t id = volume->GetInstanceID();
+  if ( id >= fVolumeTable.size() ) fVolumeTable.resize(id + 1);
+  auto& record = fVolumeTable[id];
+  if ( ! record.valid ) record = MakeRecord(volume);
+  return record;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -43,11 +260,19 @@ void CalorimeterSD::Initialize(G4HCofThisEvent* hce)
     = G4SDManager::GetSDMpointer()->GetCollectionID(collectionName[0]);
   hce->AddHitsCollection( hcID, fHitsCollection ); 
 
-  // Create hits
-  // fNofCells for cells + one more for total sums 
-  for (G4int i=0; i<fNofCells+1; i++ ) {
-    fHitsCollection->insert(new CalorHit());
-  }
+  SetHitsCollection(fHitsCollection);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::SetHitsCollection(CalorHitsCollection* collection)
+{
+  fHitsCollection = collection;
+
+  // Only the hit for the total sums, cell hits are created when touched
+  fHitsCollection->insert(new CalorHit());
+  fHitIndex.Clear();
+  for ( auto& batch : fBatches ) batch.count = 0;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -58,49 +283,217 @@ G4bool CalorimeterSD::ProcessHits(G4Step* step,
   // energy deposit
   auto edep = step->GetTotalEnergyDeposit();
   
-  // step length
-  G4double stepLength = 0.;
+  // step length, only used for Birk's formula, which applies only to charged particles
+  G4double charge = step->GetTrack()->GetDefinition()->GetPDGCharge();
+  G4double stepLength = ( charge != 0. ) ? step->GetStepLength() : 0.;
+  if ( edep==0. && stepLength == 0. ) return true;      
 
-  if ( step->GetTrack()->GetDefinition()->GetPDGCharge() != 0. ) {  // Only using step length for Birk's formula, which applies only to charged particles
-    stepLength = step->GetStepLength();  
+  // Integration window of the step, deposits outside all windows are not seen by the electronics
+  G4int window = -1;
+  if ( GlobalValues::NumTimeWindows > 0 ) {
+    auto time = step->GetPreStepPoint()->GetGlobalTime() - GlobalValues::TimeWindowStart;
+    if ( time < 0. ) return true;
+    window = G4int(time/GlobalValues::TimeWindowWidth);
+    if ( window >= GlobalValues::NumTimeWindows ) return true;
   }
-  if ( edep==0. && stepLength == 0. ) return true;      
+
   auto touchable = (step->GetPreStepPoint()->GetTouchable());
-  
-  auto volume = step->GetPreStepPoint()->GetTouchableHandle()->GetVolume();
+
+  // The step itself in the mass geometry, the mass-geometry step of the track in a parallel world
+  auto massPoint = step->GetTrack()->GetStep()->GetPreStepPoint();
+  auto massVolume = massPoint->GetPhysicalVolume()->GetLogicalVolume();
+  auto touchableVolume = touchable->GetVolume()->GetLogicalVolume();
+
+  // Cell and fiber depth of the touchable, read before the mass lookup can grow the table
+  G4int cellDepth, fiberDepth;
+  G4bool optical;
+  {
+    const auto& cell = fUseVolumeTable ? GetRecord(touchableVolume) : (fRecordCopy = MakeRecord(touchableVolume));
+    cellDepth = cell.cellDepth;
+    fiberDepth = cell.fiberDepth;
+    optical = cell.optical;
+  }
+
+  // Scoring, quenching and energy scale of the mass volume, copied only without the table
+  const auto& mass = fUseVolumeTable ? GetRecord(massVolume) : (fRecordCopy = MakeRecord(massVolume));
+  if ( ! mass.scored ) return true;
+
   // Get calorimeter cell id 
-  auto layerNumber = touchable->GetReplicaNumber(1);
+  auto copyNo = touchable->GetCopyNumber(cellDepth);
+  auto x = CellID::CopyX(copyNo);
+  auto y = CellID::CopyY(copyNo);
+  if ( fSubdivision > 1 ) {
+    x = x*fSubdivision + touchable->GetReplicaNumber(fSubXDepth);
+    y = y*fSubdivision + fSubdivision - 1 - touchable->GetReplicaNumber(fSubYDepth);
+  }
+  auto cellNumber = (x*fNofXY + y)*fNofLayers;
+  if ( fLayerDepth >= 0 ) cellNumber += touchable->GetReplicaNumber(fLayerDepth);
+
+  // Fiber group inside the block, stored + 1 so that 0 stays the whole block
+  G4int fiber = ( fiberDepth >= 0 && ! fFiberGroup.empty() ) ? touchable->GetCopyNumber(fiberDepth) : -1;
 
   // Get hit accounting data for this cell
-  auto hit = (*fHitsCollection)[layerNumber];
-  if ( ! hit ) {
+  if ( x >= fNofXY || y >= fNofXY || cellNumber < 0 || cellNumber >= fNofCells
+       || fiber >= G4int(fFiberGroup.size()) ) {
     G4ExceptionDescription msg;
-    msg << "Cannot access hit " << layerNumber; 
+    msg << "Cannot access hit " << cellNumber << " fiber " << fiber; 
     G4Exception("CalorimeterSD::ProcessHits()",
       "MyCode0004", FatalException, msg);
   }         
+  G4int layer = ( fLayerDepth >= 0 ) ? cellNumber % fNofLayers : 0;
+  auto id = CellID::Encode(fSubsystem, x, y, layer, ( fiber >= 0 ) ? fFiberGroup[fiber] + 1 : 0);
+
+  auto index = fHitIndex.Find(id);
+  if ( index < 0 ) {
+    auto hit = new CalorHit();
+    hit->SetCellID(id);
+    index = G4int(fHitsCollection->entries());
+    fHitIndex.Insert(id, index);
+    fHitsCollection->insert(hit);
+  }
+
+  // Photoelectrons per MeV at the readout end, attenuated from the step midpoint along the fiber
+  G4double light = 0.;
+  if ( optical && fLightYield > 0. ) {
+    auto midpoint = 0.5*(step->GetPreStepPoint()->GetPosition() + step->GetPostStepPoint()->GetPosition());
+    auto localZ = touchable->GetHistory()->GetTopTransform().TransformPoint(midpoint).z();
+    light = fLightYield*GetAttenuation(fFiberHalfLength - localZ);
+  }
+
+  // Stopping power for the quenching, 0 for neutral steps
+  G4double dEdx = ( stepLength > 0. ) ? edep/stepLength : 0.;
+
+  // Deferred: quenched and added to the hits with the rest of the batch of its model in FlushBatch()
+  if ( fBatchSize > 0 ) {
+    auto& batch = fBatches[mass.quenching.model];
+    if ( mass.quenching.model == Quenching::kTabulated && batch.table != mass.quenching.table ) {
+      FlushBatch<Quenching::Tabulated>(batch);
+      batch.table = mass.quenching.table;
+    }
+    auto k = batch.count++;
+    batch.hit[k] = index;
+    batch.window[k] = window;
+    batch.edep[k] = edep;
+    batch.length[k] = stepLength;
+    batch.dEdx[k] = dEdx;
+    batch.birks[k] = mass.quenching.birks;
+    batch.chou[k] = mass.quenching.chou;
+    batch.scale[k] = mass.energyScale;
+    batch.light[k] = light;
+    if ( batch.count == fBatchSize ) FlushBatch();
+    return true;
+  }
+
+  auto hit = (*fHitsCollection)[index];
 
   // Get hit for total accounting
   auto hitTotal 
-    = (*fHitsCollection)[fHitsCollection->entries()-1];
+    = (*fHitsCollection)[0];
 
-  // Adjusting the energy for the Birk's constant
-  G4Material* mat = volume->GetLogicalVolume()->GetMaterial();
-  G4double charge = step->GetTrack()->GetDefinition()->GetPDGCharge();
-  G4double birk = mat->GetIonisation()->GetBirksConstant();
-  if(birk*edep*stepLength*charge !=0) edep /= (1. + birk*edep/stepLength); // Done for charged particles in organic scintillators
+  // Quenching model of the material, Birks' law for organic scintillators by default
+  edep = mass.quench(mass.quenching, edep, dEdx);
+
+  if ( light > 0. ) {
+    hit->AddPhotoelectrons(light*edep);
+    hitTotal->AddPhotoelectrons(light*edep);
+  }
+
+  edep *= mass.energyScale;
 
   // Add values
   hit->Add(edep, stepLength);
   hitTotal->Add(edep, stepLength); 
+  if ( window >= 0 ) {
+    hit->AddInWindow(window, edep);
+    hitTotal->AddInWindow(window, edep);
+  }
   
   return true;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void CalorimeterSD::SetBatchSize(G4int size)
+{
+  FlushBatch();
+  fBatchSize = std::max(size, 0);
+  for ( auto& batch : fBatches ) {
+    batch.count = 0;
+    batch.hit.resize(fBatchSize);
+    batch.window.resize(fBatchSize);
+    batch.edep.resize(fBatchSize);
+    batch.length.resize(fBatchSize);
+    batch.dEdx.resize(fBatchSize);
+    batch.birks.resize(fBatchSize);
+    batch.chou.resize(fBatchSize);
+    batch.scale.resize(fBatchSize);
+    batch.light.resize(fBatchSize);
+    batch.deposit.resize(fBatchSize);
+    batch.npe.resize(fBatchSize);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void CalorimeterSD::FlushBatch()
+{
+  // One loop per quenching model, no dispatch per step
+  FlushBatch<Quenching::None>(fBatches[Quenching::kNone]);
+  FlushBatch<Quenching::Birks>(fBatches[Quenching::kBirks]);
+  FlushBatch<Quenching::Chou>(fBatches[Quenching::kChou]);
+  FlushBatch<Quenching::Tabulated>(fBatches[Quenching::kTabulated]);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+template<class Policy>
+void CalorimeterSD::FlushBatch(StepBatch& batch)
+{
+  const G4int n = batch.count;
+  if ( n == 0 ) return;
+  batch.count = 0;
+
+  // Quenching, energy scale and photoelectrons of the whole batch in one loop
+  Quenching::Apply<Policy>(n, batch.edep.data(), batch.dEdx.data(), batch.birks.data(), batch.chou.data(),
+                           batch.table, batch.scale.data(), batch.light.data(),
+                           batch.deposit.data(), batch.npe.data());
+
+  // Reduction per cell, the totals once per batch
+  G4double totalEdep = 0., totalLength = 0., totalNpe = 0.;
+  auto hitTotal = (*fHitsCollection)[0];
+  for ( G4int k = 0; k < n; k++ ) {
+    auto hit = (*fHitsCollection)[batch.hit[k]];
+    hit->Add(batch.deposit[k], batch.length[k]);
+    if ( batch.npe[k] > 0. ) hit->AddPhotoelectrons(batch.npe[k]);
+    if ( batch.window[k] >= 0 ) {
+      hit->AddInWindow(batch.window[k], batch.deposit[k]);
+      hitTotal->AddInWindow(batch.window[k], batch.deposit[k]);
+    }
+    totalEdep += batch.deposit[k];
+    totalLength += batch.length[k];
+    totalNpe += batch.npe[k];
+  }
+  hitTotal->Add(totalEdep, totalLength, n);
+  hitTotal->AddPhotoelectrons(totalNpe);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 void CalorimeterSD::EndOfEvent(G4HCofThisEvent*)
 {
+  FlushBatch();
+
+  // Photostatistics per cell, the total is the sum of the sampled cells
+  if ( fLightYield > 0. ) {
+    G4double total = 0.;
+    for ( std::size_t i = 1; i < fHitsCollection->entries(); ++i ) {
+      auto hit = (*fHitsCollection)[i];
+      if ( hit->GetPhotoelectrons() > 0. ) hit->SetPhotoelectrons(G4Poisson(hit->GetPhotoelectrons()));
+      total += hit->GetPhotoelectrons();
+    }
+    (*fHitsCollection)[0]->SetPhotoelectrons(total);
+  }
+
   if ( verboseLevel>1 ) { 
      auto nofHits = fHitsCollection->entries();
      G4cout
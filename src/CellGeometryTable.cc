@@ -0,0 +1,147 @@
+/// \file CellGeometryTable.cc
+/// \brief Implementation of the CellGeometryTable class
+
+#include "CellGeometryTable.hh"
+#include "CellID.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4TransportationManager.hh"
+#include "G4Box.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <fstream>
+#include <iomanip>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  G4VPhysicalVolume* FindDaughter(const G4LogicalVolume* mother, const G4String& name)
+  {
+    for(std::size_t i = 0; i < mother->GetNoDaughters(); i++)
+      if(mother->GetDaughter(i)->GetName() == name) return mother->GetDaughter(i);
+    return nullptr;
+  }
+
+  const G4Box* Box(const G4VPhysicalVolume* pv)
+  {
+    return static_cast<const G4Box*>(pv->GetLogicalVolume()->GetSolid());
+  }
+
+  // Centre of copy k of a cartesian replica of the given width along its axis
+  G4double ReplicaCentre(const G4VPhysicalVolume* replica, G4int k)
+  {
+    EAxis axis;
+    G4int nReplicas;
+    G4double width, offset;
+    G4bool consuming;
+    replica->GetReplicationData(axis, nReplicas, width, offset, consuming);
+    return -width*(nReplicas - 1)*0.5 + k*width;
+  }
+
+  void WriteCell(std::ofstream& output, CellID::Type id, const G4ThreeVector& centre, const G4ThreeVector& half)
+  {
+    output << id << " " << centre.x()/mm << " " << centre.y()/mm << " " << centre.z()/mm
+           << " " << half.x()/mm << " " << half.y()/mm << " " << half.z()/mm << "\n";
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int CellGeometryTable::Write(const G4String& fileName)
+{
+  std::ofstream output(fileName);
+  if(!output)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the cell geometry table " << fileName;
+    G4Exception("CellGeometryTable::Write()",
+      "MyCode0019", JustWarning, msg);
+    return 0;
+  }
+  output << "# cellID x y z dx dy dz (centre and half sizes in mm)\n" << std::setprecision(8);
+
+  G4int nCells = 0;
+  auto worldLV = G4LogicalVolumeStore::GetInstance()->GetVolume("WorldLogical");
+  for(std::size_t i = 0; i < worldLV->GetNoDaughters(); i++)
+  {
+    auto pv = worldLV->GetDaughter(i);
+    G4int copyNo = pv->GetCopyNo();
+    G4int x = CellID::CopyX(copyNo);
+    G4int y = CellID::CopyY(copyNo);
+
+    if(pv->GetName() == "ECalPhysical")
+    {
+      auto box = Box(pv);
+      WriteCell(output, CellID::Encode(CellID::kECal, x, y), pv->GetTranslation(),
+                G4ThreeVector(box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength()));
+      nCells++;
+    }
+    else if(pv->GetName() == "HCalPhysical")
+    {
+      // tower / layer holder / layer replica / active plate
+      auto holderPV = FindDaughter(pv->GetLogicalVolume(), "HCalLayerHolderPhysical");
+      auto layerPV = holderPV->GetLogicalVolume()->GetDaughter(0);
+      auto activePV = FindDaughter(layerPV->GetLogicalVolume(), "HCalActivePhysical");
+      auto box = Box(activePV);
+      G4ThreeVector half(box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength());
+      G4ThreeVector front = pv->GetTranslation() + holderPV->GetTranslation() + activePV->GetTranslation();
+
+      G4int nLayers = layerPV->GetMultiplicity();
+      for(G4int layer = 0; layer < nLayers; layer++)
+      {
+        WriteCell(output, CellID::Encode(CellID::kHCal, x, y, layer),
+                  front + G4ThreeVector(0., 0., ReplicaCentre(layerPV, layer)), half);
+        nCells++;
+      }
+    }
+  }
+
+  // Readout cells of the parallel world
+  auto readoutPV = G4TransportationManager::GetTransportationManager()->IsWorldExisting("ReadoutWorld");
+  auto readoutLV = readoutPV ? readoutPV->GetLogicalVolume() : nullptr;
+  for(std::size_t i = 0; readoutLV && i < readoutLV->GetNoDaughters(); i++)
+  {
+    auto pv = readoutLV->GetDaughter(i);
+    G4int copyNo = pv->GetCopyNo();
+    G4int x = CellID::CopyX(copyNo);
+    G4int y = CellID::CopyY(copyNo);
+
+    if(pv->GetName() == "ECalReadoutPhysical")
+    {
+      // block envelope / column replica along x / cell replica along y, counted towards -y like the blocks
+      auto columnPV = pv->GetLogicalVolume()->GetDaughter(0);
+      auto cellPV = columnPV->GetLogicalVolume()->GetDaughter(0);
+      auto box = Box(cellPV);
+      G4int n = columnPV->GetMultiplicity();
+      for(G4int a = 0; a < n; a++)
+      {
+        for(G4int b = 0; b < n; b++)
+        {
+          G4ThreeVector centre = pv->GetTranslation() + G4ThreeVector(ReplicaCentre(columnPV, a), ReplicaCentre(cellPV, b), 0.);
+          WriteCell(output, CellID::Encode(CellID::kECalReadout, x*n + a, y*n + n - 1 - b), centre,
+                    G4ThreeVector(box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength()));
+          nCells++;
+        }
+      }
+    }
+    else if(pv->GetName() == "HCalReadoutPhysical")
+    {
+      auto sectionPV = pv->GetLogicalVolume()->GetDaughter(0);
+      auto box = Box(sectionPV);
+      for(G4int section = 0; section < sectionPV->GetMultiplicity(); section++)
+      {
+        WriteCell(output, CellID::Encode(CellID::kHCalReadout, x, y, section),
+                  pv->GetTranslation() + G4ThreeVector(0., 0., ReplicaCentre(sectionPV, section)),
+                  G4ThreeVector(box->GetXHalfLength(), box->GetYHalfLength(), box->GetZHalfLength()));
+        nCells++;
+      }
+    }
+  }
+
+  return nCells;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,237 @@
+/// \file ConstructionProfiler.cc
+/// \brief Implementation of the ConstructionProfiler class
+
+#include "ConstructionProfiler.hh"
+
+#include "G4SolidStore.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4SmartVoxelHeader.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <unistd.h>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  struct VoxelCount
+  {
+    G4int headers = 0;
+    G4int proxies = 0;
+    G4int nodes = 0;
+    G4long slices = 0;
+    G4long contained = 0;
+    G4int depth = 0;
+    G4double buildTime = -1.;
+
+    G4double Memory() const
+    {
+      return headers*sizeof(G4SmartVoxelHeader) + proxies*sizeof(G4SmartVoxelProxy)
+           + nodes*sizeof(G4SmartVoxelNode) + slices*sizeof(G4SmartVoxelProxy*)
+           + contained*sizeof(G4int);
+    }
+  };
+
+  // Equal neighbouring slices share their proxy, so every object is counted once
+  void CountVoxels(G4SmartVoxelHeader* header, G4int depth, std::set<const void*>& seen, VoxelCount& count)
+  {
+    if(!seen.insert(header).second) return;
+    count.headers++;
+    count.depth = std::max(count.depth, depth);
+    count.slices += header->GetNoSlices();
+    for(std::size_t i = 0; i < header->GetNoSlices(); i++)
+    {
+      auto proxy = header->GetSlice(i);
+      if(!seen.insert(proxy).second) continue;
+      count.proxies++;
+      if(proxy->IsHeader()) CountVoxels(proxy->GetHeader(), depth + 1, seen, count);
+      else if(seen.insert(proxy->GetNode()).second)
+      {
+        count.nodes++;
+        count.contained += proxy->GetNode()->GetNoContained();
+      }
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ConstructionProfiler::ConstructionProfiler()
+ : fRunning(false),
+   fReported(false),
+   fReportFile(""),
+   fVoxelTiming(false)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ConstructionProfiler::~ConstructionProfiler()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ConstructionProfiler::GetResidentMemory()
+{
+  std::ifstream statm("/proc/self/statm");
+  G4double size = 0., resident = 0.;
+  if(!(statm >> size >> resident)) return 0.;
+  return resident*sysconf(_SC_PAGESIZE);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConstructionProfiler::Reset()
+{
+  fStages.clear();
+  fRunning = false;
+  fReported = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConstructionProfiler::Begin(const G4String& stage)
+{
+  End();
+  Stage newStage;
+  newStage.name = stage;
+  newStage.time = 0.;
+  newStage.memoryBefore = GetResidentMemory();
+  newStage.memoryAfter = newStage.memoryBefore;
+  fStages.push_back(newStage);
+  fRunning = true;
+  fTimer.Start();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConstructionProfiler::End()
+{
+  if(!fRunning) return;
+  fTimer.Stop();
+  fStages.back().time = fTimer.GetRealElapsed();
+  fStages.back().memoryAfter = GetResidentMemory();
+  fRunning = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ConstructionProfiler::Report()
+{
+  if(fReported) return;
+  fReported = true;
+  End();
+
+  // Inventory
+  auto solids = G4SolidStore::GetInstance();
+  auto logicals = G4LogicalVolumeStore::GetInstance();
+  auto physicals = G4PhysicalVolumeStore::GetInstance();
+  G4int nReplicated = 0, nParameterised = 0;
+  for(auto pv : *physicals)
+  {
+    if(pv->IsParameterised()) nParameterised++;
+    else if(pv->IsReplicated()) nReplicated++;
+  }
+
+  std::vector<G4LogicalVolume*> mothers;
+  std::vector<VoxelCount> voxels;
+  for(auto lv : *logicals)
+  {
+    if(lv->GetNoDaughters() == 0) continue;
+    mothers.push_back(lv);
+
+    VoxelCount count;
+    std::set<const void*> seen;
+    if(lv->GetVoxelHeader()) CountVoxels(lv->GetVoxelHeader(), 0, seen, count);
+    if(fVoxelTiming && lv->GetVoxelHeader())
+    {
+      G4Timer timer;
+      timer.Start();
+      auto header = new G4SmartVoxelHeader(lv);
+      timer.Stop();
+      delete header;
+      count.buildTime = timer.GetRealElapsed();
+    }
+    voxels.push_back(count);
+  }
+
+  G4double totalTime = 0.;
+  for(const auto& stage : fStages) totalTime += stage.time;
+
+  // Print
+  G4cout << G4endl << "Geometry construction profile (" << totalTime << " s):" << G4endl;
+  for(const auto& stage : fStages)
+  {
+    G4cout << "  " << std::setw(16) << std::left << stage.name << std::right
+           << std::setw(10) << stage.time << " s"
+           << std::setw(10) << std::showpos << (stage.memoryAfter - stage.memoryBefore)/1.e6 << std::noshowpos << " MB"
+           << std::setw(10) << stage.memoryAfter/1.e6 << " MB resident" << G4endl;
+  }
+  G4cout << "Geometry inventory: " << solids->size() << " solids, " << logicals->size() << " logical volumes, "
+         << physicals->size() << " physical volumes (" << nReplicated << " replicated, "
+         << nParameterised << " parameterised)" << G4endl;
+  for(std::size_t i = 0; i < mothers.size(); i++)
+  {
+    G4int nCopies = 0;
+    for(std::size_t d = 0; d < mothers[i]->GetNoDaughters(); d++) nCopies += mothers[i]->GetDaughter(d)->GetMultiplicity();
+    G4cout << "  " << std::setw(28) << std::left << mothers[i]->GetName() << std::right
+           << std::setw(6) << mothers[i]->GetNoDaughters() << " daughters" << std::setw(7) << nCopies << " copies, voxels: "
+           << voxels[i].headers << " headers, " << voxels[i].nodes << " nodes, depth " << voxels[i].depth << ", "
+           << voxels[i].Memory()/1.e3 << " kB";
+    if(voxels[i].buildTime >= 0.) G4cout << ", " << voxels[i].buildTime << " s";
+    G4cout << G4endl;
+  }
+
+  if(fReportFile.empty()) return;
+
+  // JSON
+  std::ofstream report(fReportFile);
+  if(!report)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the construction profile " << fReportFile;
+    G4Exception("ConstructionProfiler::Report()",
+      "MyCode0014", JustWarning, msg);
+    return;
+  }
+  report << "{\n  \"total_seconds\": " << totalTime << ",\n  \"stages\": [";
+  for(std::size_t i = 0; i < fStages.size(); i++)
+  {
+    report << (i ? "," : "") << "\n    {\"name\": \"" << fStages[i].name << "\""
+           << ", \"seconds\": " << fStages[i].time
+           << ", \"rss_before_bytes\": " << std::fixed << std::setprecision(0) << fStages[i].memoryBefore
+           << ", \"rss_after_bytes\": " << fStages[i].memoryAfter << std::defaultfloat << std::setprecision(6) << "}";
+  }
+  report << "\n  ],\n"
+         << "  \"solids\": " << solids->size() << ",\n"
+         << "  \"logical_volumes\": " << logicals->size() << ",\n"
+         << "  \"physical_volumes\": " << physicals->size() << ",\n"
+         << "  \"replicated_volumes\": " << nReplicated << ",\n"
+         << "  \"parameterised_volumes\": " << nParameterised << ",\n"
+         << "  \"mothers\": [";
+  for(std::size_t i = 0; i < mothers.size(); i++)
+  {
+    G4int nCopies = 0;
+    for(std::size_t d = 0; d < mothers[i]->GetNoDaughters(); d++) nCopies += mothers[i]->GetDaughter(d)->GetMultiplicity();
+    report << (i ? "," : "") << "\n    {\"logical_volume\": \"" << mothers[i]->GetName() << "\""
+           << ", \"daughters\": " << mothers[i]->GetNoDaughters()
+           << ", \"copies\": " << nCopies
+           << ", \"voxel_headers\": " << voxels[i].headers
+           << ", \"voxel_nodes\": " << voxels[i].nodes
+           << ", \"voxel_slices\": " << voxels[i].slices
+           << ", \"voxel_depth\": " << voxels[i].depth
+           << ", \"voxel_bytes\": " << std::fixed << std::setprecision(0) << voxels[i].Memory() << std::defaultfloat << std::setprecision(6);
+    if(voxels[i].buildTime >= 0.) report << ", \"voxel_seconds\": " << voxels[i].buildTime;
+    report << "}";
+  }
+  report << "\n  ]\n}\n";
+  G4cout << "Geometry construction profile written to " << fReportFile << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
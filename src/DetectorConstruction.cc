@@ -4,6 +4,19 @@
 
 #include "DetectorConstruction.hh"
 #include "CalorimeterSD.hh"
+#include "UnifiedCalorimeterSD.hh"
+#include "ECalFiberParameterisation.hh"
+#include "ECalLatticeNavigation.hh"
+#include "NavigationBenchmark.hh"
+#include "SDBenchmark.hh"
+#include "GeometryCache.hh"
+#include "OverlapChecker.hh"
+#include "MaterialScan.hh"
+#include "ConstructionProfiler.hh"
+#include "GeometryRebuild.hh"
+#include "VoxelTuner.hh"
+#include "CellID.hh"
+#include "RunAction.hh"
 #include "G4Material.hh"
 #include "G4NistManager.hh"
 
@@ -13,6 +26,21 @@
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
 #include "G4PVReplica.hh"
+#include "G4PVParameterised.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4ProductionCutsTable.hh"
+#include "G4TransportationManager.hh"
+#include "G4Navigator.hh"
+#include "G4GenericMessenger.hh"
+#include "G4Timer.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4Threading.hh"
+#include "G4UnitsTable.hh"
 #include "G4GlobalMagFieldMessenger.hh"
 #include "G4AutoDelete.hh"
 
@@ -24,6 +52,14 @@
 #include "G4PhysicalConstants.hh"
 #include "G4SystemOfUnits.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
 using namespace GlobalValues;
 
 
@@ -31,30 +67,924 @@ using namespace GlobalValues;
 
 G4ThreadLocal 
 G4GlobalMagFieldMessenger* DetectorConstruction::fMagFieldMessenger = 0; 
+G4ThreadLocal
+ECalLatticeNavigation* DetectorConstruction::fLatticeNavigation = nullptr;
  //
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 DetectorConstruction::DetectorConstruction()
  : G4VUserDetectorConstruction(),
-   fCheckOverlaps(false)
+   fMessenger(nullptr),
+   fCheckOverlaps(false),
+   fFiberPlacement("parameterised"),
+   fFiberNavigation("voxel"),
+   fECalMode("fiber"),
+   fECalSamplingFraction(1.),
+   fGeometryCacheDir(""),
+   fAbsorberPlateThickness(20.*mm),
+   fActivePlateThickness(3.*mm),
+   fECalFiberRadius(0.235*mm),
+   fECalFiberXPitch(0.95865*mm),
+   fECalFiberYPitch(0.820*mm),
+   fOverlapThreads(0),
+   fOverlapTolerance(0.),
+   fOverlapReport("overlaps.json"),
+   fScanThreads(0),
+   fScanHalfWidth(350.*mm),
+   fScanAngles(1),
+   fScanMaxAngle(0.),
+   fScanFile("material_scan.txt"),
+   fProfiler(new ConstructionProfiler),
+   fProfileReport(""),
+   fProfileVoxels(false),
+   fECalCut(0.),
+   fHCalAbsorberCut(0.),
+   fHCalActiveCut(0.),
+   fPassiveCut(0.),
+   fEndcapInnerRadius(0.),
+   fEndcapOuterRadius(0.),
+   fVoxelSettings(""),
+   fVoxelTuningTracks(2000),
+   fUnifiedSD(false),
+   fECalDetailX(0.),
+   fECalDetailY(0.),
+   fECalDetailRadius(0.),
+   fECalGranularity("block"),
+   fECalBundleRows(4),
+   fECalBundleCols(4),
+   fECalFiberRows(0),
+   fECalFiberCols(0),
+   fECalFiberLength(0.),
+   fFiberLightYield(0.),
+   fFiberAttenuationLength(3.5*m),
+   fSDBatchSize(0),
+   fRebuild(new GeometryRebuild),
+   fWorldPV(nullptr)
 {
+  DefineCommands();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 DetectorConstruction::~DetectorConstruction()
 { 
+  delete fMessenger;
+  delete fProfiler;
+  delete fRebuild;
 }  
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 G4VPhysicalVolume* DetectorConstruction::Construct()
 {
+  G4Timer timer;
+  timer.Start();
+  fProfiler->Reset();
+  fRebuild->Reset();
+
   // Define materials 
+  fProfiler->Begin("materials");
   DefineMaterials();
   
   // Define volumes
-  return DefineVolumes();
+  auto worldPV = DefineVolumes();
+
+  // Tuned voxel settings, before the geometry is closed
+  if(!fVoxelSettings.empty())
+  {
+    fProfiler->Begin("voxel settings");
+    G4int nSet = VoxelTuner::ApplySettings(fVoxelSettings);
+    if(nSet > 0) G4cout << "Voxel settings of " << nSet << " logical volumes read from " << fVoxelSettings << G4endl;
+  }
+  fProfiler->End();
+
+  timer.Stop();
+  G4cout << "Geometry construction took " << timer.GetRealElapsed() << " s, "
+         << G4PhysicalVolumeStore::GetInstance()->size()
+         << " physical volumes (ECal mode: " << fECalMode
+         << ", fiber placement mode: " << fFiberPlacement << ")"
+         << G4endl;
+
+  return worldPV;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/athena/geometry/", "Geometry control");
+
+  auto& placementCmd
+    = fMessenger->DeclareProperty("fiberPlacement", fFiberPlacement,
+        "ECal fiber placement mode: one G4PVPlacement per fiber (placement)\n"
+        "or one G4PVParameterised per block (parameterised).");
+  placementCmd.SetParameterName("mode", false);
+  placementCmd.SetCandidates("placement parameterised");
+  placementCmd.SetDefaultValue("parameterised");
+  placementCmd.SetStates(G4State_PreInit);
+
+  auto& navigationCmd
+    = fMessenger->DeclareProperty("fiberNavigation", fFiberNavigation,
+        "Navigation of the parameterised ECal fibers: Geant4 smart voxels (voxel)\n"
+        "or direct lattice lookup (lattice).");
+  navigationCmd.SetParameterName("mode", false);
+  navigationCmd.SetCandidates("voxel lattice");
+  navigationCmd.SetDefaultValue("voxel");
+  navigationCmd.SetStates(G4State_PreInit);
+
+  auto& benchmarkCmd
+    = fMessenger->DeclareMethod("benchmarkNavigation", &DetectorConstruction::BenchmarkNavigation,
+        "Time voxel and lattice navigation of the ECal fibers with random tracks.");
+  benchmarkCmd.SetParameterName("nTracks", true);
+  benchmarkCmd.SetDefaultValue("10000");
+  benchmarkCmd.SetStates(G4State_Idle);
+
+  auto& benchmarkSDCmd
+    = fMessenger->DeclareMethod("benchmarkSD", &DetectorConstruction::BenchmarkSD,
+        "Time the ECal and HCal ProcessHits with and without the per-volume table\n"
+        "on nSteps synthetic steps.");
+  benchmarkSDCmd.SetParameterName("nSteps", true);
+  benchmarkSDCmd.SetDefaultValue("10000000");
+  benchmarkSDCmd.SetStates(G4State_Idle);
+
+  auto& ecalModeCmd
+    = fMessenger->DeclareMethod("ecalMode", &DetectorConstruction::SetECalMode,
+        "ECal blocks with individual fibers (fiber), homogenised W/scintillator\n"
+        "blocks scored through the sampling fraction (mixture), or fibers only in the\n"
+        "blocks near the beam impact point and mixture blocks elsewhere (mixed).");
+  ecalModeCmd.SetParameterName("mode", false);
+  ecalModeCmd.SetCandidates("fiber mixture mixed");
+  ecalModeCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& detailXCmd
+    = fMessenger->DeclareMethodWithUnit("ecalDetailX", "mm", &DetectorConstruction::SetECalDetailX,
+        "x of the beam impact point, around which mixed ECal blocks keep their fibers.");
+  detailXCmd.SetParameterName("x", false);
+  detailXCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& detailYCmd
+    = fMessenger->DeclareMethodWithUnit("ecalDetailY", "mm", &DetectorConstruction::SetECalDetailY,
+        "y of the beam impact point, around which mixed ECal blocks keep their fibers.");
+  detailYCmd.SetParameterName("y", false);
+  detailYCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& detailRadiusCmd
+    = fMessenger->DeclareMethodWithUnit("ecalDetailRadius", "mm", &DetectorConstruction::SetECalDetailRadius,
+        "Mixed ECal blocks reaching within this distance of the impact point keep their fibers,\n"
+        "0 for the block containing it only.");
+  detailRadiusCmd.SetParameterName("radius", false);
+  detailRadiusCmd.SetRange("radius>=0.");
+  detailRadiusCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& granularityCmd
+    = fMessenger->DeclareMethod("ecalGranularity", &DetectorConstruction::SetECalGranularity,
+        "ECal readout cells: whole blocks (block), single fibers (fiber), bundles of\n"
+        "ecalBundleRows x ecalBundleCols fibers (bundle) or block quadrants (quadrant).\n"
+        "Sub-block cells are written to the ECalSubCells ntuple.");
+  granularityCmd.SetParameterName("granularity", false);
+  granularityCmd.SetCandidates("block fiber bundle quadrant");
+  granularityCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& bundleRowsCmd
+    = fMessenger->DeclareMethod("ecalBundleRows", &DetectorConstruction::SetECalBundleRows,
+        "Fiber rows per ECal readout bundle.");
+  bundleRowsCmd.SetParameterName("n", false);
+  bundleRowsCmd.SetRange("n>0");
+  bundleRowsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& bundleColsCmd
+    = fMessenger->DeclareMethod("ecalBundleCols", &DetectorConstruction::SetECalBundleCols,
+        "Fiber columns per ECal readout bundle.");
+  bundleColsCmd.SetParameterName("n", false);
+  bundleColsCmd.SetRange("n>0");
+  bundleColsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& lightYieldCmd
+    = fMessenger->DeclareMethod("fiberLightYield", &DetectorConstruction::SetFiberLightYield,
+        "Photoelectrons per MeV of (Birks-corrected) fiber deposit at the readout end,\n"
+        "0 to score energy only. Fills the ECal_Npe columns instead of optical photon transport.\n"
+        "Not available with the unified SD.");
+  lightYieldCmd.SetParameterName("yield", false);
+  lightYieldCmd.SetRange("yield>=0.");
+  lightYieldCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& attenuationCmd
+    = fMessenger->DeclareMethodWithUnit("fiberAttenuationLength", "mm", &DetectorConstruction::SetFiberAttenuationLength,
+        "Attenuation length of the ECal fibers for fiberLightYield.");
+  attenuationCmd.SetParameterName("length", false);
+  attenuationCmd.SetRange("length>0.");
+  attenuationCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& batchSizeCmd
+    = fMessenger->DeclareMethod("sdBatchSize", &DetectorConstruction::SetSDBatchSize,
+        "Steps the ECal and HCal SDs collect before quenching them in one batch,\n"
+        "0 to process every step at once.");
+  batchSizeCmd.SetParameterName("size", false);
+  batchSizeCmd.SetRange("size>=0");
+  batchSizeCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& quenchingCmd
+    = fMessenger->DeclareMethod("quenching", &DetectorConstruction::SetQuenching,
+        "Quenching model of the steps in a material, in the ECal and HCal SDs:\n"
+        "  material none\n"
+        "  material birks [kB]   Birks' law, kB in mm/MeV, the material's constant if omitted\n"
+        "  material chou kB C    second order, kB in mm/MeV and C in (mm/MeV)^2\n"
+        "  material table file   light fraction at equal steps of dE/dx, two columns\n"
+        "                        dE/dx (MeV/mm, from 0) and fraction.\n"
+        "Other materials follow Birks' law with their own constant.");
+  quenchingCmd.SetParameterName("setting", false);
+  quenchingCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& samplingFractionCmd
+    = fMessenger->DeclareMethod("ecalSamplingFraction", &DetectorConstruction::SetECalSamplingFraction,
+        "Sampling fraction applied to the energy deposited in mixture ECal blocks.");
+  samplingFractionCmd.SetParameterName("fraction", false);
+  samplingFractionCmd.SetRange("fraction>0.");
+  samplingFractionCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& calibrateCmd
+    = fMessenger->DeclareMethod("calibrateECal", &DetectorConstruction::CalibrateECal,
+        "Run nEvents with fiber and with mixture ECal blocks using the current\n"
+        "primary generator, then switch to mixture blocks (or back to mixed blocks)\n"
+        "with the measured sampling fraction.");
+  calibrateCmd.SetParameterName("nEvents", true);
+  calibrateCmd.SetDefaultValue("1000");
+  calibrateCmd.SetStates(G4State_Idle);
+
+  auto& cacheCmd
+    = fMessenger->DeclareProperty("cacheDir", fGeometryCacheDir,
+        "Directory of the GDML geometry cache, shared between jobs.\n"
+        "The cache is disabled if empty.");
+  cacheCmd.SetParameterName("directory", false);
+  cacheCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // Sampling structure
+  auto& hcalLayersCmd
+    = fMessenger->DeclareMethod("numHCalLayers", &DetectorConstruction::SetNumHCalLayers,
+        "Number of HCal layers.");
+  hcalLayersCmd.SetParameterName("n", false);
+  hcalLayersCmd.SetRange("n>0 && n<1024");
+  hcalLayersCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& hcalTowersCmd
+    = fMessenger->DeclareMethod("numHCalTowers", &DetectorConstruction::SetNumHCalTowers,
+        "Number of HCal towers along x and y.");
+  hcalTowersCmd.SetParameterName("n", false);
+  hcalTowersCmd.SetRange("n>0 && n<1024");
+  hcalTowersCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& ecalBlocksCmd
+    = fMessenger->DeclareMethod("numECalBlocks", &DetectorConstruction::SetNumECalBlocks,
+        "Number of ECal blocks along x and y, must be even (2x2 blocks per HCal tower).");
+  ecalBlocksCmd.SetParameterName("n", false);
+  ecalBlocksCmd.SetRange("n>0 && n<1024");
+  ecalBlocksCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& absorberCmd
+    = fMessenger->DeclareMethodWithUnit("absorberThickness", "mm", &DetectorConstruction::SetAbsorberPlateThickness,
+        "Thickness of the HCal absorber plates.");
+  absorberCmd.SetParameterName("thickness", false);
+  absorberCmd.SetRange("thickness>0.");
+  absorberCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& activeCmd
+    = fMessenger->DeclareMethodWithUnit("activeThickness", "mm", &DetectorConstruction::SetActivePlateThickness,
+        "Thickness of the HCal scintillator plates.");
+  activeCmd.SetParameterName("thickness", false);
+  activeCmd.SetRange("thickness>0.");
+  activeCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& fiberRadiusCmd
+    = fMessenger->DeclareMethodWithUnit("fiberRadius", "mm", &DetectorConstruction::SetECalFiberRadius,
+        "Radius of the ECal fibers including the cladding.");
+  fiberRadiusCmd.SetParameterName("radius", false);
+  fiberRadiusCmd.SetRange("radius>0.");
+  fiberRadiusCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& fiberXPitchCmd
+    = fMessenger->DeclareMethodWithUnit("fiberXPitch", "mm", &DetectorConstruction::SetECalFiberXPitch,
+        "Distance between ECal fibers in a row.");
+  fiberXPitchCmd.SetParameterName("pitch", false);
+  fiberXPitchCmd.SetRange("pitch>0.");
+  fiberXPitchCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& fiberYPitchCmd
+    = fMessenger->DeclareMethodWithUnit("fiberYPitch", "mm", &DetectorConstruction::SetECalFiberYPitch,
+        "Distance between ECal fiber rows.");
+  fiberYPitchCmd.SetParameterName("pitch", false);
+  fiberYPitchCmd.SetRange("pitch>0.");
+  fiberYPitchCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // Endcap layout, the square array is trimmed to an annulus
+  auto& endcapInnerCmd
+    = fMessenger->DeclareMethodWithUnit("endcapInnerRadius", "mm", &DetectorConstruction::SetEndcapInnerRadius,
+        "Radius of the beam hole: towers and 2x2 block groups reaching inside it are not placed.");
+  endcapInnerCmd.SetParameterName("radius", false);
+  endcapInnerCmd.SetRange("radius>=0.");
+  endcapInnerCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& endcapOuterCmd
+    = fMessenger->DeclareMethodWithUnit("endcapOuterRadius", "mm", &DetectorConstruction::SetEndcapOuterRadius,
+        "Outer radius of the endcap: towers and 2x2 block groups reaching outside it are not placed,\n"
+        "0 for the full square array.");
+  endcapOuterCmd.SetParameterName("radius", false);
+  endcapOuterCmd.SetRange("radius>=0.");
+  endcapOuterCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& unifiedSDCmd
+    = fMessenger->DeclareMethod("unifiedSD", &DetectorConstruction::SetUnifiedSD,
+        "Score the ECal and HCal with one SD accumulating into flat per-cell arrays\n"
+        "instead of a hits collection per subsystem.");
+  unifiedSDCmd.SetParameterName("flag", false);
+  unifiedSDCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& sparseOutputCmd
+    = fMessenger->DeclareProperty("sparseOutput", SparseOutput,
+        "Write only the touched towers, blocks and tiles to the ntuples instead of every cell.");
+  sparseOutputCmd.SetParameterName("flag", false);
+  sparseOutputCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // Integration windows of the electronics
+  auto& timeWindowsCmd
+    = fMessenger->DeclareProperty("timeWindows", NumTimeWindows,
+        "Number of integration windows, 0 to score every deposit whatever its time.\n"
+        "Deposits outside the windows are not scored, more than one window fills the CellWindows ntuple.");
+  timeWindowsCmd.SetParameterName("n", false);
+  timeWindowsCmd.SetRange("n>=0 && n<=8");
+  timeWindowsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& timeWindowStartCmd
+    = fMessenger->DeclarePropertyWithUnit("timeWindowStart", "ns", TimeWindowStart,
+        "Global time of the start of the first integration window.");
+  timeWindowStartCmd.SetParameterName("time", false);
+  timeWindowStartCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& timeWindowWidthCmd
+    = fMessenger->DeclarePropertyWithUnit("timeWindowWidth", "ns", TimeWindowWidth,
+        "Width of each integration window.");
+  timeWindowWidthCmd.SetParameterName("width", false);
+  timeWindowWidthCmd.SetRange("width>0.");
+  timeWindowWidthCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& killLateTracksCmd
+    = fMessenger->DeclareProperty("killLateTracks", KillLateTracks,
+        "Kill tracks whose global time is past the last integration window.");
+  killLateTracksCmd.SetParameterName("flag", false);
+  killLateTracksCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // Geometry validation
+  auto& placementCheckCmd
+    = fMessenger->DeclareProperty("placementOverlapCheck", fCheckOverlaps,
+        "Check every placement for overlaps during construction (slow).");
+  placementCheckCmd.SetParameterName("flag", false);
+  placementCheckCmd.SetStates(G4State_PreInit);
+
+  auto& overlapThreadsCmd
+    = fMessenger->DeclareProperty("overlapThreads", fOverlapThreads,
+        "Number of threads of checkOverlaps, 0 for all cores.");
+  overlapThreadsCmd.SetParameterName("n", false);
+  overlapThreadsCmd.SetRange("n>=0");
+
+  auto& overlapToleranceCmd
+    = fMessenger->DeclarePropertyWithUnit("overlapTolerance", "mm", fOverlapTolerance,
+        "Overlaps up to this depth are ignored by checkOverlaps.");
+  overlapToleranceCmd.SetParameterName("tolerance", false);
+  overlapToleranceCmd.SetRange("tolerance>=0.");
+
+  auto& overlapReportCmd
+    = fMessenger->DeclareProperty("overlapReport", fOverlapReport,
+        "JSON report file of checkOverlaps.");
+  overlapReportCmd.SetParameterName("file", false);
+
+  auto& checkOverlapsCmd
+    = fMessenger->DeclareMethod("checkOverlaps", &DetectorConstruction::CheckOverlaps,
+        "Check every logical volume for overlaps of its daughters with nPoints\n"
+        "surface points in total, spread over overlapThreads threads.");
+  checkOverlapsCmd.SetParameterName("nPoints", true);
+  checkOverlapsCmd.SetDefaultValue("1000000");
+  checkOverlapsCmd.SetStates(G4State_Idle);
+
+  // Material budget
+  auto& scanThreadsCmd
+    = fMessenger->DeclareProperty("scanThreads", fScanThreads,
+        "Number of threads of scanMaterial, 0 for all cores.");
+  scanThreadsCmd.SetParameterName("n", false);
+  scanThreadsCmd.SetRange("n>=0");
+
+  auto& scanHalfWidthCmd
+    = fMessenger->DeclarePropertyWithUnit("scanHalfWidth", "mm", fScanHalfWidth,
+        "Half width in x and y of the grid of scanMaterial at the front face of the detector.");
+  scanHalfWidthCmd.SetParameterName("halfWidth", false);
+  scanHalfWidthCmd.SetRange("halfWidth>0.");
+
+  auto& scanAnglesCmd
+    = fMessenger->DeclareProperty("scanAngles", fScanAngles,
+        "Number of ray angles of scanMaterial, from 0 to scanMaxAngle towards +y.");
+  scanAnglesCmd.SetParameterName("n", false);
+  scanAnglesCmd.SetRange("n>0");
+
+  auto& scanMaxAngleCmd
+    = fMessenger->DeclarePropertyWithUnit("scanMaxAngle", "deg", fScanMaxAngle,
+        "Largest ray angle of scanMaterial.");
+  scanMaxAngleCmd.SetParameterName("angle", false);
+  scanMaxAngleCmd.SetRange("angle>=0.");
+
+  auto& scanFileCmd
+    = fMessenger->DeclareProperty("scanFile", fScanFile,
+        "Output of scanMaterial, a text table for TTree::ReadFile.");
+  scanFileCmd.SetParameterName("file", false);
+
+  auto& scanMaterialCmd
+    = fMessenger->DeclareMethod("scanMaterial", &DetectorConstruction::ScanMaterial,
+        "Cast nBins x nBins rays per angle through the geometry and write the radiation\n"
+        "and interaction lengths per volume category to scanFile.");
+  scanMaterialCmd.SetParameterName("nBins", true);
+  scanMaterialCmd.SetDefaultValue("140");
+  scanMaterialCmd.SetRange("nBins>0");
+  scanMaterialCmd.SetStates(G4State_Idle);
+
+  // Construction profile, printed at the start of the first run after construction
+  auto& profileReportCmd
+    = fMessenger->DeclareProperty("profileReport", fProfileReport,
+        "JSON file for the geometry construction profile and inventory, none if empty.");
+  profileReportCmd.SetParameterName("file", false);
+
+  auto& profileVoxelsCmd
+    = fMessenger->DeclareProperty("profileVoxels", fProfileVoxels,
+        "Time the smart voxels of every mother by building them once more.");
+  profileVoxelsCmd.SetParameterName("flag", false);
+
+  // Production cuts of the regions
+  auto& ecalCutCmd
+    = fMessenger->DeclareMethodWithUnit("ecalCut", "mm", &DetectorConstruction::SetECalCut,
+        "Production cut of the ECal region (blocks, fibers and glue), 0 for the /run/setCut value.");
+  ecalCutCmd.SetParameterName("cut", false);
+  ecalCutCmd.SetRange("cut>=0.");
+  ecalCutCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& hcalAbsorberCutCmd
+    = fMessenger->DeclareMethodWithUnit("hcalAbsorberCut", "mm", &DetectorConstruction::SetHCalAbsorberCut,
+        "Production cut of the HCal absorber plates, 0 for the /run/setCut value.");
+  hcalAbsorberCutCmd.SetParameterName("cut", false);
+  hcalAbsorberCutCmd.SetRange("cut>=0.");
+  hcalAbsorberCutCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& hcalActiveCutCmd
+    = fMessenger->DeclareMethodWithUnit("hcalActiveCut", "mm", &DetectorConstruction::SetHCalActiveCut,
+        "Production cut of the HCal scintillator plates, 0 for the /run/setCut value.");
+  hcalActiveCutCmd.SetParameterName("cut", false);
+  hcalActiveCutCmd.SetRange("cut>=0.");
+  hcalActiveCutCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& passiveCutCmd
+    = fMessenger->DeclareMethodWithUnit("passiveCut", "mm", &DetectorConstruction::SetPassiveCut,
+        "Production cut of the HCal WLS and steel, 0 for the /run/setCut value.");
+  passiveCutCmd.SetParameterName("cut", false);
+  passiveCutCmd.SetRange("cut>=0.");
+  passiveCutCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  // Voxel tuning
+  auto& voxelSettingsCmd
+    = fMessenger->DeclareProperty("voxelSettings", fVoxelSettings,
+        "File of tuned voxel settings, written by tuneVoxels and applied at every\n"
+        "construction. Default voxelisation if empty.");
+  voxelSettingsCmd.SetParameterName("file", false);
+
+  auto& voxelTracksCmd
+    = fMessenger->DeclareProperty("voxelTuningTracks", fVoxelTuningTracks,
+        "Number of tracks sampled by tuneVoxels.");
+  voxelTracksCmd.SetParameterName("n", false);
+  voxelTracksCmd.SetRange("n>0");
+
+  auto& tuneVoxelsCmd
+    = fMessenger->DeclareMethod("tuneVoxels", &DetectorConstruction::TuneVoxels,
+        "Run nEvents with the current primary generator, sample voxelTuningTracks of their tracks\n"
+        "and time their navigation with several smartless values for every mother volume.\n"
+        "The fastest settings are kept and written to voxelSettings.");
+  tuneVoxelsCmd.SetParameterName("nEvents", true);
+  tuneVoxelsCmd.SetDefaultValue("100");
+  tuneVoxelsCmd.SetStates(G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::BenchmarkNavigation(G4int nTracks)
+{
+  NavigationBenchmark::RunECalLattice(nTracks);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::BenchmarkSD(G4int nSteps)
+{
+  auto worldPV = G4TransportationManager::GetTransportationManager()
+                   ->GetNavigatorForTracking()->GetWorldVolume();
+  if(worldPV != G4PhysicalVolumeStore::GetInstance()->GetVolume("WorldPhysical", false))
+  {
+    G4ExceptionDescription msg;
+    msg << "The geometry has been modified, run /run/beamOn 0 to build it before the SD benchmark.";
+    G4Exception("DetectorConstruction::BenchmarkSD()",
+      "MyCode0013", JustWarning, msg);
+    return;
+  }
+
+  // Unregistered copies of the SDs, configured like those of the workers
+  std::unique_ptr<CalorimeterSD> ECalSD(NewECalSD("ECalBenchmarkSD", "ECalBenchmarkHits"));
+  SDBenchmark::Run(worldPV, ECalSD.get(), ConfigureECalSD(ECalSD.get()), nSteps);
+  std::unique_ptr<CalorimeterSD> HCalSD(NewHCalSD("HCalBenchmarkSD", "HCalBenchmarkHits"));
+  SDBenchmark::Run(worldPV, HCalSD.get(), ConfigureHCalSD(HCalSD.get()), nSteps);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::CheckOverlaps(G4int nPoints)
+{
+  auto worldPV = G4TransportationManager::GetTransportationManager()
+                   ->GetNavigatorForTracking()->GetWorldVolume();
+  if(worldPV != G4PhysicalVolumeStore::GetInstance()->GetVolume("WorldPhysical", false))
+  {
+    G4ExceptionDescription msg;
+    msg << "The geometry has been modified, run /run/beamOn 0 to build it before checking overlaps.";
+    G4Exception("DetectorConstruction::CheckOverlaps()",
+      "MyCode0013", JustWarning, msg);
+    return;
+  }
+  OverlapChecker::Run(worldPV, nPoints, fOverlapThreads, fOverlapTolerance, fOverlapReport);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::ScanMaterial(G4int nBins)
+{
+  auto worldPV = G4TransportationManager::GetTransportationManager()
+                   ->GetNavigatorForTracking()->GetWorldVolume();
+  if(worldPV != G4PhysicalVolumeStore::GetInstance()->GetVolume("WorldPhysical", false))
+  {
+    G4ExceptionDescription msg;
+    msg << "The geometry has been modified, run /run/beamOn 0 to build it before scanning the material.";
+    G4Exception("DetectorConstruction::ScanMaterial()",
+      "MyCode0013", JustWarning, msg);
+    return;
+  }
+  MaterialScan::Run(worldPV, nBins, fScanHalfWidth, fScanAngles, fScanMaxAngle, fScanThreads, fScanFile);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::TuneVoxels(G4int nEvents)
+{
+  // Tracks are sampled by TrackingAction during a normal run
+  VoxelTuner::StartRecording(fVoxelTuningTracks);
+  G4RunManager::GetRunManager()->BeamOn(nEvents);
+  VoxelTuner::StopRecording();
+
+  // The geometry is still closed after the run
+  auto worldPV = G4TransportationManager::GetTransportationManager()
+                   ->GetNavigatorForTracking()->GetWorldVolume();
+  VoxelTuner::Run(worldPV, fVoxelSettings);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::GeometryHasChanged()
+{
+  // After /run/initialize the new geometry is built at the next BeamOn.
+  // The volumes are not destroyed first: DefineVolumes() rebuilds only the
+  // subsystems whose parameters changed. Materials and production cuts are
+  // kept as well, so the physics tables are only rebuilt for material-cuts
+  // couples that are new, e.g. after a switch to mixture ECal blocks.
+  if(G4StateManager::GetStateManager()->GetCurrentState() == G4State_Idle)
+    G4RunManager::GetRunManager()->ReinitializeGeometry(false);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetECalMode(const G4String& mode)
+{
+  if(mode == fECalMode) return;
+  fECalMode = mode;
+  GeometryHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetNumHCalLayers(G4int n)
+{
+  NumHCalLayers = n;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetNumHCalTowers(G4int n)
+{
+  NumHCalTowers = n;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetNumECalBlocks(G4int n)
+{
+  if(n % 2 != 0)
+  {
+    G4ExceptionDescription msg;
+    msg << "The number of ECal blocks must be even, keeping " << NumECalBlocks;
+    G4Exception("DetectorConstruction::SetNumECalBlocks()",
+      "MyCode0010", JustWarning, msg);
+    return;
+  }
+  NumECalBlocks = n;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetAbsorberPlateThickness(G4double thickness)
+{
+  fAbsorberPlateThickness = thickness;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetActivePlateThickness(G4double thickness)
+{
+  fActivePlateThickness = thickness;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalFiberRadius(G4double radius)
+{
+  fECalFiberRadius = radius;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalFiberXPitch(G4double pitch)
+{
+  fECalFiberXPitch = pitch;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalFiberYPitch(G4double pitch)
+{
+  fECalFiberYPitch = pitch;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetEndcapInnerRadius(G4double radius)
+{
+  fEndcapInnerRadius = radius;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetEndcapOuterRadius(G4double radius)
+{
+  fEndcapOuterRadius = radius;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalDetailX(G4double x)
+{
+  fECalDetailX = x;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalDetailY(G4double y)
+{
+  fECalDetailY = y;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalDetailRadius(G4double radius)
+{
+  fECalDetailRadius = radius;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalSamplingFraction(G4double fraction)
+{
+  fECalSamplingFraction = fraction;
+  GeometryHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// The readout granularity only changes the SDs. The re-initialisation keeps
+// every volume and reassigns the SDs on all threads.
+
+void DetectorConstruction::SetECalGranularity(const G4String& granularity)
+{
+  if(granularity == fECalGranularity) return;
+  fECalGranularity = granularity;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalBundleRows(G4int n)
+{
+  fECalBundleRows = n;
+  if(fECalGranularity == "bundle") GeometryHasChanged();
+}
+
+void DetectorConstruction::SetECalBundleCols(G4int n)
+{
+  fECalBundleCols = n;
+  if(fECalGranularity == "bundle") GeometryHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Like the granularity, the light model only reconfigures the SDs
+
+void DetectorConstruction::SetFiberLightYield(G4double yield)
+{
+  fFiberLightYield = yield;
+  GeometryHasChanged();
+}
+
+void DetectorConstruction::SetFiberAttenuationLength(G4double length)
+{
+  fFiberAttenuationLength = length;
+  if(fFiberLightYield > 0.) GeometryHasChanged();
+}
+
+void DetectorConstruction::SetSDBatchSize(G4int size)
+{
+  fSDBatchSize = size;
+  GeometryHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetQuenching(const G4String& setting)
+{
+  std::istringstream fields(setting);
+  std::string material, model, argument;
+  fields >> material >> model;
+
+  Quenching::Parameters parameters;
+  Quenching::Table table;
+  G4bool valid = !material.empty();
+  if(model == "none")
+  {
+    parameters.model = Quenching::kNone;
+  }
+  else if(model == "birks")
+  {
+    parameters.model = Quenching::kBirks;
+    parameters.birks = -1.; // the material's
+    if(!(fields >> std::ws).eof())
+    {
+      valid = valid && (fields >> parameters.birks) && parameters.birks >= 0.;
+      parameters.birks *= mm/MeV;
+    }
+  }
+  else if(model == "chou")
+  {
+    parameters.model = Quenching::kChou;
+    valid = valid && (fields >> parameters.birks >> parameters.chou);
+    parameters.birks *= mm/MeV;
+    parameters.chou *= (mm/MeV)*(mm/MeV);
+  }
+  else if(model == "table")
+  {
+    parameters.model = Quenching::kTabulated;
+    std::ifstream input;
+    if(valid && fields >> argument) input.open(argument);
+    std::vector<G4double> dEdx;
+    std::string line;
+    while(std::getline(input, line))
+    {
+      if(line.empty() || line[0] == '#') continue;
+      std::istringstream columns(line);
+      G4double x, factor;
+      if(!(columns >> x >> factor)) continue;
+      dEdx.push_back(x*MeV/mm);
+      table.factor.push_back(factor);
+    }
+    // Equal steps from dE/dx = 0
+    valid = valid && dEdx.size() >= 2 && dEdx[0] == 0.;
+    if(valid) table.dEdxStep = dEdx[1];
+    for(std::size_t n = 1; valid && n < dEdx.size(); n++)
+      valid = std::abs(dEdx[n] - n*table.dEdxStep) < 1.e-6*dEdx[n];
+  }
+  else valid = false;
+
+  if(!valid)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot read the quenching setting \"" << setting << "\", it is ignored.";
+    G4Exception("DetectorConstruction::SetQuenching()",
+      "MyCode0024", JustWarning, msg);
+    return;
+  }
+
+  fQuenching[material] = parameters;
+  if(parameters.model == Quenching::kTabulated) fQuenchingTables[material] = table;
+  GeometryHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+template<class SD>
+void DetectorConstruction::ConfigureQuenching(SD* sd) const
+{
+  sd->ClearQuenching();
+  for(const auto& setting : fQuenching)
+  {
+    auto material = G4Material::GetMaterial(setting.first, false);
+    if(!material)
+    {
+      G4ExceptionDescription msg;
+      msg << "No material " << setting.first << " for the quenching setting.";
+      G4Exception("DetectorConstruction::ConfigureQuenching()",
+        "MyCode0024", JustWarning, msg);
+      continue;
+    }
+    auto parameters = setting.second;
+    if(parameters.birks < 0.) parameters.birks = material->GetIonisation()->GetBirksConstant();
+    if(parameters.model == Quenching::kTabulated) parameters.table = &fQuenchingTables.at(setting.first);
+    sd->SetQuenching(material, parameters);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool DetectorConstruction::InEndcap(G4double x, G4double y, G4double halfX, G4double halfY) const
+{
+  // The whole footprint must lie inside the outer radius and outside the beam hole
+  G4double farX = std::abs(x) + halfX;
+  G4double farY = std::abs(y) + halfY;
+  if(fEndcapOuterRadius > 0. && std::hypot(farX, farY) > fEndcapOuterRadius) return false;
+
+  G4double nearX = std::max(0., std::abs(x) - halfX);
+  G4double nearY = std::max(0., std::abs(y) - halfY);
+  return std::hypot(nearX, nearY) >= fEndcapInnerRadius;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+// Cut changes are picked up by the next BeamOn, the geometry is not rebuilt
+
+void DetectorConstruction::SetECalCut(G4double cut)
+{
+  fECalCut = cut;
+  SetRegionCut("ECal", cut);
+}
+
+void DetectorConstruction::SetHCalAbsorberCut(G4double cut)
+{
+  fHCalAbsorberCut = cut;
+  SetRegionCut("HCalAbsorber", cut);
+}
+
+void DetectorConstruction::SetHCalActiveCut(G4double cut)
+{
+  fHCalActiveCut = cut;
+  SetRegionCut("HCalActive", cut);
+}
+
+void DetectorConstruction::SetPassiveCut(G4double cut)
+{
+  fPassiveCut = cut;
+  SetRegionCut("Passive", cut);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::CalibrateECal(G4int nEvents)
+{
+  auto runManager = G4RunManager::GetRunManager();
+  auto runAction = static_cast<const RunAction*>(runManager->GetUserRunAction());
+  G4double previousFraction = fECalSamplingFraction;
+  G4String finalMode = (fECalMode == "mixed") ? "mixed" : "mixture";
+
+  ECalCalibrationRun = true;
+
+  // Visible energy with the full fiber geometry
+  SetECalMode("fiber");
+  runManager->BeamOn(nEvents);
+  G4double visibleEdep = runAction->GetMeanECalEdep();
+
+  // Deposited energy in the homogenised blocks, unscaled
+  fECalSamplingFraction = 1.;
+  SetECalMode("mixture");
+  runManager->BeamOn(nEvents);
+  G4double mixtureEdep = runAction->GetMeanECalEdep();
+
+  ECalCalibrationRun = false;
+
+  if(mixtureEdep <= 0.)
+  {
+    fECalSamplingFraction = previousFraction;
+    G4ExceptionDescription msg;
+    msg << "No energy deposited in the mixture ECal blocks in " << nEvents
+        << " events, keeping the sampling fraction " << fECalSamplingFraction;
+    G4Exception("DetectorConstruction::CalibrateECal()",
+      "MyCode0008", JustWarning, msg);
+  }
+  else fECalSamplingFraction = visibleEdep/mixtureEdep;
+  SetECalMode(finalMode);
+
+  // The SDs pick up the new scale when the geometry is built again
+  GeometryHasChanged();
+
+  G4cout << "ECal calibration with " << nEvents << " events: visible energy (fiber) "
+         << G4BestUnit(visibleEdep, "Energy") << ", deposited energy (mixture) "
+         << G4BestUnit(mixtureEdep, "Energy") << G4endl
+         << "ECal sampling fraction set to " << fECalSamplingFraction << G4endl;
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -63,10 +993,29 @@ void DetectorConstruction::DefineMaterials()
 { 
   auto nistManager = G4NistManager::Instance();
   nistManager->FindOrBuildMaterial("G4_Fe"); // Using iron for steel
-  nistManager->FindOrBuildMaterial("G4_POLYSTYRENE"); // Fiber core material
+  auto ActiveMaterial = nistManager->FindOrBuildMaterial("G4_POLYSTYRENE"); // Fiber core material
   nistManager->FindOrBuildMaterial("G4_PLEXIGLASS"); // PMMA for fiber cladding
   nistManager->FindOrBuildMaterial("G4_Galactic"); // Vacuum
 
+  // Materials survive geometry re-initialisation, so they are only built once
+  if(!G4Material::GetMaterial("ECalAbsorberMaterial", false))
+  {
+    G4MaterialPropertiesTable* MaterialTable = new G4MaterialPropertiesTable();
+    ActiveMaterial->SetMaterialPropertiesTable(MaterialTable);
+    ActiveMaterial->GetIonisation()->SetBirksConstant(0.126*mm/MeV);
+
+    //G4Element* elW = new G4Element("Tungsten", "W", 74., 183.842*g/mole);
+    G4Element* elW = new G4Element("Tungsten", "W", 74., 183.85*g/mole);
+    G4Material* ECalAbsorberMaterial = new G4Material("ECalAbsorberMaterial", 12.72*g/cm3, 2);
+    ECalAbsorberMaterial->AddElement(elW, 97.0*perCent); // Use mass fraction
+    ECalAbsorberMaterial->AddMaterial(ActiveMaterial, 3.0*perCent); // Use mass fraction
+
+    // Homogenised ECal block: absorber, fibers and cladding smeared together
+    G4Material* ECalMixtureMaterial = new G4Material("ECalMixtureMaterial", 10.15*g/cm3, 2);
+    ECalMixtureMaterial->AddElement(elW, 94.8*perCent); // Use mass fraction
+    ECalMixtureMaterial->AddMaterial(ActiveMaterial, 5.2*perCent); // Use mass fraction
+  }
+
   // Print materials
   // G4cout << *(G4Material::GetMaterialTable()) << G4endl;
 }
@@ -78,8 +1027,8 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   G4cout<<"Constructing Geometry..."<<G4endl;
 
   // HCal Tower Geometry parameters
-  G4double AbsorberPlateThickness = 20.*mm; 
-  G4double ActivePlateThickness =  3.*mm;
+  G4double AbsorberPlateThickness = fAbsorberPlateThickness;
+  G4double ActivePlateThickness = fActivePlateThickness;
   G4double HCal_X = 100*mm; // x-dimension of each HCal tower
   G4double HCal_Y = 98.897*mm; // y-dimension of each HCal tower
   G4double HCal_WLS_X = 4.0*mm; // Will have a vertical wavelength-shifting plate in between towers
@@ -93,11 +1042,45 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   G4double ECal_Thickness = 170*mm; // z-dimension of each ECal block
   G4double ECal_Glue_XY = 0.1*mm; // Glue connecting ECal blocks -- see design specs
   G4double Clearance_Gap = 0.1*mm; // Gap between each set of 4 blocks -- see design specs
-  G4double ECal_Fiber_r = 0.235*mm; // Radius of each fiber in ECal
-  G4int ECal_Fiber_Rows = 60; // Number of fiber rows in each ECal block
-  G4int ECal_Fiber_Cols = 52; // Number of fiber columns in each ECal block
+  G4double ECal_Fiber_r = fECalFiberRadius; // Radius of each fiber in ECal
+  G4double ECal_Fiber_XPitch = fECalFiberXPitch; // Distance between fibers in a row
+  G4double ECal_Fiber_YPitch = fECalFiberYPitch; // Distance between fiber rows
+  // As many rows and columns as fit in the block (60x52 for the default pitch), centred in x and y.
+  // Odd rows are shifted by half a pitch, so the rows together span Cols - 1/2 pitches in x.
+  G4int ECal_Fiber_Rows = G4int((ECal_Y - 2.*ECal_Fiber_r)/ECal_Fiber_YPitch) + 1; // Number of fiber rows in each ECal block
+  G4int ECal_Fiber_Cols = G4int((ECal_X - 2.*ECal_Fiber_r)/ECal_Fiber_XPitch + 0.5); // Number of fiber columns in each ECal block
+  G4double ECal_Fiber_X0 = (ECal_Fiber_Cols - 0.5)*ECal_Fiber_XPitch/2.; // x of the first fiber in even rows, odd rows are shifted by half a pitch
+  G4double ECal_Fiber_Y0 = (ECal_Fiber_Rows - 1)*ECal_Fiber_YPitch/2.; // y of the first fiber row
+  fECalFiberRows = ECal_Fiber_Rows; // for the readout granularity of the ECal SD
+  fECalFiberCols = ECal_Fiber_Cols;
+  fECalFiberLength = ECal_Thickness; // for the light model of the ECal SD
+
+  // Fibers in the same row and in neighbouring rows must not touch
+  if(std::min(ECal_Fiber_XPitch, std::hypot(ECal_Fiber_XPitch/2., ECal_Fiber_YPitch)) < 2.*ECal_Fiber_r)
+  {
+    G4ExceptionDescription msg;
+    msg << "ECal fibers of radius " << ECal_Fiber_r/mm << " mm overlap with pitch "
+        << ECal_Fiber_XPitch/mm << " x " << ECal_Fiber_YPitch/mm << " mm";
+    G4Exception("DetectorConstruction::DefineVolumes()",
+      "MyCode0011", FatalException, msg);
+  }
 
-  auto worldSizeXY = 10 * HCal_X;
+  // ECalLatticeNavigation only tests the nearest row, which needs rows further apart than a fiber diameter
+  if(fECalMode != "mixture" && fFiberNavigation == "lattice" && fFiberPlacement == "parameterised"
+     && ECal_Fiber_YPitch <= 2.*ECal_Fiber_r)
+  {
+    G4ExceptionDescription msg;
+    msg << "Lattice navigation needs a fiber row pitch above the fiber diameter, got "
+        << ECal_Fiber_YPitch/mm << " mm for a radius of " << ECal_Fiber_r/mm << " mm."
+        << " Use /athena/geometry/fiberNavigation voxel.";
+    G4Exception("DetectorConstruction::DefineVolumes()",
+      "MyCode0011", FatalException, msg);
+  }
+
+  // ECal blocks come in groups of 2x2 in front of one HCal tower, centred on the HCal
+  G4double ECal_Offset = NumECalBlocks/4.; // x (y) of the first group edge in units of HCal_X (HCal_Y)
+
+  auto worldSizeXY = (std::max(G4double(NumHCalTowers), NumECalBlocks/2.) + 4) * HCal_X; // 2x2 ECal blocks per HCal tower width
   auto worldSizeZ  = 2. * (HCal_Thickness + ECal_Thickness); // Arbitrary sizes larger than the detector
   //auto worldSizeXY = 10*m;
   //auto worldSizeZ  = 10*m; // Arbitrary sizes larger than the detector
@@ -115,352 +1098,452 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   //ActiveMaterial->AddElement(elC, 8);
   //ActiveMaterial->GetIonisation()->SetBirksConstant(0.126*mm/MeV);
 
-  //G4Element* elW = new G4Element("Tungsten", "W", 74., 183.842*g/mole);
-  G4Element* elW = new G4Element("Tungsten", "W", 74., 183.85*g/mole);
-  G4Material* ECalAbsorberMaterial = new G4Material("ECalAbsorberMaterial", 12.72*g/cm3, 2);
-  ECalAbsorberMaterial->AddElement(elW, 97.0*perCent); // Use mass fraction
-  ECalAbsorberMaterial->AddMaterial(ActiveMaterial, 3.0*perCent); // Use mass fraction
-
-  //G4Material* ECal_abs_mat = new G4Material("ECal_fiber_mat", 10.15*g/cm3, 2);
-  //ECal_abs_mat->AddElement(elW, 94.8*perCent); // Use mass fraction
-  //ECal_abs_mat->AddMaterial(ActiveMaterial, 5.2*perCent); // Use mass fraction
-
-  G4MaterialPropertiesTable* MaterialTable = new G4MaterialPropertiesTable();
-  ActiveMaterial->SetMaterialPropertiesTable(MaterialTable);
-  ActiveMaterial->GetIonisation()->SetBirksConstant(0.126*mm/MeV);
+  auto ECalAbsorberMaterial = G4Material::GetMaterial("ECalAbsorberMaterial");
+  auto ECalMixtureMaterial = G4Material::GetMaterial("ECalMixtureMaterial");
   
-  if ( !DefaultMaterial || !AbsorberPlateMaterial || !ActiveMaterial || !CladdingMaterial || !ECalAbsorberMaterial ) 
+  if ( !DefaultMaterial || !AbsorberPlateMaterial || !ActiveMaterial || !CladdingMaterial || !ECalAbsorberMaterial || !ECalMixtureMaterial ) 
   {
     G4ExceptionDescription msg;
     msg << "Cannot retrieve materials already defined."; 
     G4Exception("DetectorConstruction::DefineVolumes()",
       "MyCode0001", FatalException, msg);
-  } 
-     
-  // World
-  auto WorldS 
-    = new G4Box("WorldSolid",           // its name
-                 worldSizeXY/2., worldSizeXY/2., worldSizeZ/2.); // its size
-                         
-  auto WorldLV
-    = new G4LogicalVolume(
-                 WorldS,           // its solid
-                 DefaultMaterial,  // its material
-                 "WorldLogical");         // its name
-                                   
-  auto worldPV
-    = new G4PVPlacement(
-                 0,                // no rotation
-                 G4ThreeVector(),  // at (0,0,0)
-                 WorldLV,          // its logical volume                         
-                 "WorldPhysical",          // its name
-                 0,                // its mother  volume
-                 false,            // no boolean operation
-                 0,                // copy number
-                 fCheckOverlaps);  // checking overlaps 
-
-  char nameHolder[200];
+  }
 
-  // HCal
-  G4LogicalVolume* HCalLV[NumHCalTowers][NumHCalTowers];
-  G4VSolid* HCalS = new G4Box("HCalSolid", HCal_X/2., HCal_Y/2., HCal_Thickness/2.);
+  // Subsystems whose parameters did not change since the previous construction
+  // keep their volumes and voxels (incremental rebuild, see GeometryHasChanged())
+  std::ostringstream HCalKey, ECalKey, WorldKey;
+  HCalKey << std::setprecision(17) << NumHCalLayers << " " << AbsorberPlateThickness << " " << ActivePlateThickness;
+  ECalKey << std::setprecision(17) << fECalMode << " " << fFiberPlacement << " " << fFiberNavigation << " "
+          << ECal_Fiber_r << " " << ECal_Fiber_XPitch << " " << ECal_Fiber_YPitch;
+  WorldKey << std::setprecision(17) << HCalKey.str() << " " << ECalKey.str() << " " << NumHCalTowers << " "
+           << NumECalBlocks << " " << fEndcapInnerRadius << " " << fEndcapOuterRadius << " "
+           << fECalDetailX << " " << fECalDetailY << " " << fECalDetailRadius;
+
+  // The previous volumes are gone after the first construction or /run/reinitializeGeometry true
+  G4bool incremental = fWorldPV && !G4LogicalVolumeStore::GetInstance()->empty();
+  if(!incremental)
+  {
+    fWorldPV = nullptr;
+    fHCalVolumes.clear();
+    fECalVolumes.clear();
+  }
+  else if(WorldKey.str() == fWorldKey)
+  {
+    G4cout << "Geometry unchanged, all volumes kept" << G4endl;
+    fRebuild->KeepVoxels({fWorldPV->GetLogicalVolume()});
+    return fWorldPV;
+  }
 
-  for(G4int i = 0; i < NumHCalTowers; i++)
+  // Geometry cache, keyed by every parameter that changes the volume tree.
+  // It is read for a complete construction only.
+  fProfiler->Begin("cache load");
+  GeometryCache cache(fGeometryCacheDir);
+  cache.AddParameter("ECalMode", fECalMode);
+  cache.AddParameter("FiberPlacement", fFiberPlacement);
+  cache.AddParameter("NumHCalLayers", NumHCalLayers);
+  cache.AddParameter("NumHCalTowers", NumHCalTowers);
+  cache.AddParameter("NumECalBlocks", NumECalBlocks);
+  cache.AddParameter("AbsorberPlateThickness", AbsorberPlateThickness);
+  cache.AddParameter("ActivePlateThickness", ActivePlateThickness);
+  cache.AddParameter("HCal_X", HCal_X);
+  cache.AddParameter("HCal_Y", HCal_Y);
+  cache.AddParameter("HCal_WLS_X", HCal_WLS_X);
+  cache.AddParameter("HCal_Steel_Y", HCal_Steel_Y);
+  cache.AddParameter("ECal_X", ECal_X);
+  cache.AddParameter("ECal_Y", ECal_Y);
+  cache.AddParameter("ECal_Thickness", ECal_Thickness);
+  cache.AddParameter("ECal_Glue_XY", ECal_Glue_XY);
+  cache.AddParameter("Clearance_Gap", Clearance_Gap);
+  cache.AddParameter("ECal_Fiber_r", ECal_Fiber_r);
+  cache.AddParameter("ECal_Fiber_Rows", ECal_Fiber_Rows);
+  cache.AddParameter("ECal_Fiber_Cols", ECal_Fiber_Cols);
+  cache.AddParameter("ECal_Fiber_XPitch", ECal_Fiber_XPitch);
+  cache.AddParameter("ECal_Fiber_YPitch", ECal_Fiber_YPitch);
+  cache.AddParameter("ECal_Fiber_X0", ECal_Fiber_X0);
+  cache.AddParameter("ECal_Fiber_Y0", ECal_Fiber_Y0);
+  cache.AddParameter("EndcapInnerRadius", fEndcapInnerRadius);
+  cache.AddParameter("EndcapOuterRadius", fEndcapOuterRadius);
+  cache.AddParameter("ECalDetailX", fECalDetailX);
+  cache.AddParameter("ECalDetailY", fECalDetailY);
+  cache.AddParameter("ECalDetailRadius", fECalDetailRadius);
+
+  auto cachedWorldPV = incremental ? nullptr : cache.Load();
+  if(cachedWorldPV)
   {
-    for(G4int j = 0; j < NumHCalTowers; j++)
+    // GDML duplicates the materials, use the ones above which carry the Birks constant
+    for(auto lv : *G4LogicalVolumeStore::GetInstance())
+      lv->SetMaterial(G4Material::GetMaterial(lv->GetMaterial()->GetName()));
+
+    // GDML reads the fibers back with a generic parameterisation, restore the lattice
+    auto ECalLV = G4LogicalVolumeStore::GetInstance()->GetVolume("ECalLogical");
+    if(fECalMode != "mixture" && fFiberPlacement == "parameterised")
     {
-      sprintf(nameHolder, "HCalLogical%d%d", i, j);
-      HCalLV[i][j] = new G4LogicalVolume(HCalS, DefaultMaterial, nameHolder);
-      sprintf(nameHolder, "HCalPhysical%d%d", i, j);
-      new G4PVPlacement(0, G4ThreeVector((-2.5 + i)*HCal_X, (2.5 - j)*HCal_Y, ECal_Thickness/2. + HCal_Thickness/2.), HCalLV[i][j], nameHolder, WorldLV, false, i+j, fCheckOverlaps);
+      auto cachedFiberPV = ECalLV->GetDaughter(0);
+      auto ECal_FiberCladdingLV = cachedFiberPV->GetLogicalVolume();
+      ECalLV->RemoveDaughter(cachedFiberPV);
+      delete cachedFiberPV;
+
+      auto ECal_FiberParam = new ECalFiberParameterisation(ECal_Fiber_Rows, ECal_Fiber_Cols,
+                                                           ECal_Fiber_XPitch, ECal_Fiber_YPitch,
+                                                           ECal_Fiber_X0, ECal_Fiber_Y0);
+      new G4PVParameterised("ECal_FiberCladdingPhysical", ECal_FiberCladdingLV, ECalLV,
+                            kUndefined, ECal_FiberParam->GetNumberOfFibers(), ECal_FiberParam, fCheckOverlaps);
+      if(fFiberNavigation == "lattice") ECalLV->ChangeDaughtersType(kExternal);
     }
-  }
-                                                     
-  // HCal Layers
 
-  // LayerHolder is used to easily replicate the layers along Z. Dimensions must account for WLS plates and steel plates
-  G4LogicalVolume* HCalLayerHolderLV[NumHCalTowers][NumHCalTowers]; 
-  G4VSolid* HCalLayerHolderS = new G4Box("HCalLayerHolderSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., HCal_Thickness/2.);
+    fProfiler->Begin("vis attributes");
+    SetVisAttributes();
+    DefineRegions();
 
-  for(G4int i = 0; i < NumHCalTowers; i++)
-  {
-    for(G4int j = 0; j < NumHCalTowers; j++)
+    // The tower variants of a trimmed endcap may be missing from the file,
+    // so both subsystems are rebuilt at the next change
+    fHCalVolumes.clear();
+    fECalVolumes.clear();
+    auto cachedWorldLV = cachedWorldPV->GetLogicalVolume();
+    for(std::size_t i = 0; i < cachedWorldLV->GetNoDaughters(); i++)
     {
-      sprintf(nameHolder, "HCalLayerHolderLogical%d%d", i, j);
-      HCalLayerHolderLV[i][j] = new G4LogicalVolume(HCalLayerHolderS, DefaultMaterial, nameHolder);
-      sprintf(nameHolder, "HCalLayerHolderPhysical%d%d", i, j);
-      new G4PVPlacement(0, G4ThreeVector(HCal_WLS_X/2., -HCal_Steel_Y/2., 0), HCalLayerHolderLV[i][j], nameHolder, HCalLV[i][j], false, 0, fCheckOverlaps);
+      auto lv = cachedWorldLV->GetDaughter(i)->GetLogicalVolume();
+      auto& volumes = (cachedWorldLV->GetDaughter(i)->GetName() == "HCalPhysical") ? fHCalVolumes : fECalVolumes;
+      if(std::find(volumes.begin(), volumes.end(), lv) == volumes.end()) volumes.push_back(lv);
     }
+    fWorldPV = cachedWorldPV;
+    fWorldKey = WorldKey.str();
+    fHCalKey = "";
+    fECalKey = "";
+    return cachedWorldPV;
   }
 
-  G4LogicalVolume* HCalLayerLV[NumHCalTowers][NumHCalTowers];
-  G4VSolid* HCalLayerS = new G4Box("HCalLayerSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., HCal_LayerThickness/2.);
+  G4bool keepHCal = incremental && HCalKey.str() == fHCalKey;
+  G4bool keepECal = incremental && ECalKey.str() == fECalKey;
+  std::vector<G4LogicalVolume*> keptVolumes;
+  if(keepHCal) keptVolumes.insert(keptVolumes.end(), fHCalVolumes.begin(), fHCalVolumes.end());
+  if(keepECal) keptVolumes.insert(keptVolumes.end(), fECalVolumes.begin(), fECalVolumes.end());
+  fRebuild->KeepVoxels(keptVolumes);
+  if(incremental)
+    G4cout << "Incremental rebuild: HCal " << (keepHCal ? "kept" : "rebuilt")
+           << ", ECal " << (keepECal ? "kept" : "rebuilt") << G4endl;
 
-  for(G4int i = 0; i < NumHCalTowers; i++)
+  // World
+  // An incremental rebuild resizes the world and replaces its daughters. The world
+  // itself is kept, because the parallel world was created with its solid.
+  fProfiler->Begin("world");
+  G4VPhysicalVolume* worldPV = fWorldPV;
+  G4LogicalVolume* WorldLV = nullptr;
+  if(incremental)
   {
-    for(G4int j = 0; j < NumHCalTowers; j++)
+    WorldLV = worldPV->GetLogicalVolume();
+    auto WorldS = static_cast<G4Box*>(WorldLV->GetSolid());
+    WorldS->SetXHalfLength(worldSizeXY/2.);
+    WorldS->SetYHalfLength(worldSizeXY/2.);
+    WorldS->SetZHalfLength(worldSizeZ/2.);
+    while(WorldLV->GetNoDaughters() > 0)
     {
-      sprintf(nameHolder, "HCalLayerLogical%d%d", i, j);
-      HCalLayerLV[i][j] = new G4LogicalVolume(HCalLayerS, DefaultMaterial, nameHolder);
-      new G4PVReplica("HCalLayerPhysical", HCalLayerLV[i][j], HCalLayerHolderLV[i][j], kZAxis, NumHCalLayers, HCal_LayerThickness);
+      auto pv = WorldLV->GetDaughter(WorldLV->GetNoDaughters() - 1);
+      WorldLV->RemoveDaughter(pv);
+      delete pv;
     }
   }
-  
-  // Absorber plates in HCal towers
-  
-  G4LogicalVolume* HCalAbsorberLV[NumHCalTowers][NumHCalTowers];
-  G4VSolid* HCalAbsorberS = new G4Box("HCalAbsorberSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., AbsorberPlateThickness/2.);
-
-  for(G4int i = 0; i < NumHCalTowers; i++)
+  else
   {
-    for(G4int j = 0; j < NumHCalTowers; j++)
-    {
-      sprintf(nameHolder, "HCalAbsorberLogical%d%d", i, j);
-      HCalAbsorberLV[i][j] = new G4LogicalVolume(HCalAbsorberS, AbsorberPlateMaterial, nameHolder);
-      sprintf(nameHolder, "HCalAbsorberPhysical%d%d", i, j);
-      new G4PVPlacement(0, G4ThreeVector(0., 0., -ActivePlateThickness/2.), HCalAbsorberLV[i][j], nameHolder, HCalLayerLV[i][j], false, 0, fCheckOverlaps);
-    }
+    auto WorldS
+      = new G4Box("WorldSolid",           // its name
+                   worldSizeXY/2., worldSizeXY/2., worldSizeZ/2.); // its size
+
+    WorldLV
+      = new G4LogicalVolume(
+                   WorldS,           // its solid
+                   DefaultMaterial,  // its material
+                   "WorldLogical");         // its name
+
+    worldPV
+      = new G4PVPlacement(
+                   0,                // no rotation
+                   G4ThreeVector(),  // at (0,0,0)
+                   WorldLV,          // its logical volume
+                   "WorldPhysical",          // its name
+                   0,                // its mother  volume
+                   false,            // no boolean operation
+                   0,                // copy number
+                   fCheckOverlaps);  // checking overlaps
   }
 
-  // Scintillating plates in HCal towers
-
-  // Behind the absorber plates in each layer
-  G4LogicalVolume* HCalActiveLV[NumHCalTowers][NumHCalTowers];
-  G4VSolid* HCalActiveS = new G4Box("HCalActiveSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., ActivePlateThickness/2.);
+  // Every HCal tower and ECal block shares one logical-volume hierarchy.
+  // Towers and blocks are identified by the copy number of their placement,
+  // copyNo = i*N + j, which CalorimeterSD decodes from the touchable.
 
-  for(G4int i = 0; i < NumHCalTowers; i++)
+  // HCal
+  fProfiler->Begin("hcal");
+  if(!keepHCal)
   {
-    for(G4int j = 0; j < NumHCalTowers; j++)
-    {
-      sprintf(nameHolder, "HCalActiveLogical%d%d", i, j);
-      HCalActiveLV[i][j] = new G4LogicalVolume(HCalActiveS, ActiveMaterial, nameHolder);
-      sprintf(nameHolder, "HCalActivePhysical%d%d", i, j);
-      new G4PVPlacement(0, G4ThreeVector(0., 0., AbsorberPlateThickness/2.), HCalActiveLV[i][j], nameHolder, HCalLayerLV[i][j], false, 0, fCheckOverlaps);
-    }
-  }
+    GeometryRebuild::DeleteTrees(fHCalVolumes);
 
-  // Wavelength shifting plates in HCal towers 
+    // LayerHolder is used to easily replicate the layers along Z. Dimensions must account for WLS plates and steel plates
+    G4VSolid* HCalLayerHolderS = new G4Box("HCalLayerHolderSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., HCal_Thickness/2.);
+    G4LogicalVolume* HCalLayerHolderLV = new G4LogicalVolume(HCalLayerHolderS, DefaultMaterial, "HCalLayerHolderLogical");
 
-  // Only in between towers. Implemented as being part of towers rather than separarte. In right side of towers. 
-  // Far right tower section does not have WLS plates.
-  G4LogicalVolume* HCalWLS_LV[NumHCalTowers-1][NumHCalTowers];
-  G4VSolid* HCalWLS_S = new G4Box("HCalWLSSolid", HCal_WLS_X/2., (HCal_Y - HCal_Steel_Y)/2., HCal_Thickness/2.);
-  for(G4int i = 1; i < NumHCalTowers; i++)
-  {
-    for(G4int j = 0; j < NumHCalTowers; j++)
+    // HCal Layers
+    G4VSolid* HCalLayerS = new G4Box("HCalLayerSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., HCal_LayerThickness/2.);
+    G4LogicalVolume* HCalLayerLV = new G4LogicalVolume(HCalLayerS, DefaultMaterial, "HCalLayerLogical");
+    new G4PVReplica("HCalLayerPhysical", HCalLayerLV, HCalLayerHolderLV, kZAxis, NumHCalLayers, HCal_LayerThickness);
+
+    // Absorber plates in HCal towers
+    G4VSolid* HCalAbsorberS = new G4Box("HCalAbsorberSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., AbsorberPlateThickness/2.);
+    G4LogicalVolume* HCalAbsorberLV = new G4LogicalVolume(HCalAbsorberS, AbsorberPlateMaterial, "HCalAbsorberLogical");
+    new G4PVPlacement(0, G4ThreeVector(0., 0., -ActivePlateThickness/2.), HCalAbsorberLV, "HCalAbsorberPhysical", HCalLayerLV, false, 0, fCheckOverlaps);
+
+    // Scintillating plates in HCal towers
+
+    // Behind the absorber plates in each layer
+    G4VSolid* HCalActiveS = new G4Box("HCalActiveSolid", (HCal_X - HCal_WLS_X)/2., (HCal_Y - HCal_Steel_Y)/2., ActivePlateThickness/2.);
+    G4LogicalVolume* HCalActiveLV = new G4LogicalVolume(HCalActiveS, ActiveMaterial, "HCalActiveLogical");
+    new G4PVPlacement(0, G4ThreeVector(0., 0., AbsorberPlateThickness/2.), HCalActiveLV, "HCalActivePhysical", HCalLayerLV, false, 0, fCheckOverlaps);
+
+    // Wavelength shifting plates in HCal towers 
+
+    // Only in between towers. Implemented as being part of towers rather than separarte. In right side of towers. 
+    // Far right tower section does not have WLS plates.
+    G4VSolid* HCalWLS_S = new G4Box("HCalWLSSolid", HCal_WLS_X/2., (HCal_Y - HCal_Steel_Y)/2., HCal_Thickness/2.);
+    G4LogicalVolume* HCalWLS_LV = new G4LogicalVolume(HCalWLS_S, ActiveMaterial, "HCalWLSLogical");
+
+    // Steel plates in HCal towers
+
+    // Only in between towers. Implemented as being part of towers rather than separarte. In top of towers.
+    // Top tower section does not have steel plates.
+    G4VSolid* HCalSteelS = new G4Box("HCalSteelSolid", HCal_X/2., HCal_Steel_Y/2., HCal_Thickness/2.); // Plates that stretch across HCal in x and z directions
+    G4LogicalVolume* HCalSteelLV = new G4LogicalVolume(HCalSteelS, AbsorberPlateMaterial, "HCalSteelLogical");
+
+    // Towers come in four variants depending on whether they hold a WLS plate (i > 0)
+    // and/or a steel plate (j > 0). Index is hasWLS + 2*hasSteel.
+    G4LogicalVolume* HCalLV[4];
+    G4VSolid* HCalS = new G4Box("HCalSolid", HCal_X/2., HCal_Y/2., HCal_Thickness/2.);
+    const char* HCalVariantNames[4] = {"HCalLogical", "HCalLogical_WLS", "HCalLogical_Steel", "HCalLogical_WLS_Steel"};
+
+    for(G4int variant = 0; variant < 4; variant++)
     {
-      sprintf(nameHolder, "HCalWLSLogical%d%d", i-1, j);
-      HCalWLS_LV[i-1][j] = new G4LogicalVolume(HCalWLS_S, ActiveMaterial, nameHolder);
-      sprintf(nameHolder, "HCalWLSPhysical%d%d", i-1, j);
-      new G4PVPlacement(0, G4ThreeVector(-(HCal_X-HCal_WLS_X)/2., -HCal_Steel_Y/2., 0), HCalWLS_LV[i-1][j], nameHolder, HCalLV[i][j], false, 0, fCheckOverlaps);
+      HCalLV[variant] = new G4LogicalVolume(HCalS, DefaultMaterial, HCalVariantNames[variant]);
+      new G4PVPlacement(0, G4ThreeVector(HCal_WLS_X/2., -HCal_Steel_Y/2., 0), HCalLayerHolderLV, "HCalLayerHolderPhysical", HCalLV[variant], false, 0, fCheckOverlaps);
+      if(variant & 1) new G4PVPlacement(0, G4ThreeVector(-(HCal_X-HCal_WLS_X)/2., -HCal_Steel_Y/2., 0), HCalWLS_LV, "HCalWLSPhysical", HCalLV[variant], false, 0, fCheckOverlaps);
+      if(variant & 2) new G4PVPlacement(0, G4ThreeVector(0, (HCal_Y-HCal_Steel_Y)/2. , 0), HCalSteelLV, "HCalSteelPhysical", HCalLV[variant], false, 0, fCheckOverlaps);
     }
-  }
 
-  // Steel plates in HCal towers
+    fHCalVolumes.assign(HCalLV, HCalLV + 4);
+  }
 
-  // Only in between towers. Implemented as being part of towers rather than separarte. In top of towers.
-  // Top tower section does not have steel plates.
-  G4LogicalVolume* HCalSteelLV[NumHCalTowers][NumHCalTowers-1];
-  G4VSolid* HCalSteelS = new G4Box("HCalSteelSolid", HCal_X/2., HCal_Steel_Y/2., HCal_Thickness/2.); // Plates that stretch across HCal in x and z directions
+  G4int num_towers = 0;
   for(G4int i = 0; i < NumHCalTowers; i++)
   {
-    for(G4int j = 1; j < NumHCalTowers; j++)
+    for(G4int j = 0; j < NumHCalTowers; j++)
     {
-      sprintf(nameHolder, "HCalSteelLogical%d%d", i, j-1);
-      HCalSteelLV[i][j-1] = new G4LogicalVolume(HCalSteelS, AbsorberPlateMaterial, nameHolder);
-      sprintf(nameHolder, "HCalSteelPhysical%d%d", i, j-1);
-      new G4PVPlacement(0, G4ThreeVector(0, (HCal_Y-HCal_Steel_Y)/2. , 0), HCalSteelLV[i][j-1], nameHolder, HCalLV[i][j], false, 0, fCheckOverlaps);
+      G4int variant = (i > 0 ? 1 : 0) + (j > 0 ? 2 : 0);
+      G4double HCal_Offset = (NumHCalTowers - 1)/2.;
+      G4double x = (-HCal_Offset + i)*HCal_X;
+      G4double y = (HCal_Offset - j)*HCal_Y;
+      if(!InEndcap(x, y, HCal_X/2., HCal_Y/2.)) continue;
+      new G4PVPlacement(0, G4ThreeVector(x, y, ECal_Thickness/2. + HCal_Thickness/2.), fHCalVolumes[variant], "HCalPhysical", WorldLV, false, CellID::CopyNumber(i, j), fCheckOverlaps);
+      num_towers++;
     }
   }
-
+  G4cout<<"Number of HCal towers: "<<num_towers<<G4endl;
 
   // ECal mixture tower structure
   //G4VSolid* ECalS = new G4Tubs("ECalSolid", 0.0*mm, 1542*mm, ECal_Thickness/2, 0, CLHEP::twopi);
   //G4LogicalVolume* ECalLV = new G4LogicalVolume(ECalS, ECal_abs_mat, "ECalLogical");
   //new G4PVPlacement(0, G4ThreeVector(0, 0, 0), ECalLV, "ECalPhysical", WorldLV, false, 0, fCheckOverlaps);
 
+  // ECal block with its fibers, and the glue
+  fProfiler->Begin("ecal fibers");
+  if(!keepECal)
+  {
+    GeometryRebuild::DeleteTrees(fECalVolumes);
+
+    G4VSolid* ECalS = new G4Box("ECalSolid", ECal_X/2., ECal_Y/2., ECal_Thickness/2.);
+    G4bool mixtureECal = (fECalMode == "mixture");
+    G4LogicalVolume* ECalLV = new G4LogicalVolume(ECalS, mixtureECal ? ECalMixtureMaterial : ECalAbsorberMaterial, "ECalLogical");
+
+    /* Horizontal glue between ECal blocks 
+      □ □
+      g g
+      □ □
+    */
+    G4VSolid* ECal_HorizGlueS = new G4Box("ECal_HorizGlueSolid", ECal_X/2., ECal_Glue_XY/2., ECal_Thickness/2.);
+    G4LogicalVolume* ECal_HorizGlueLV = new G4LogicalVolume(ECal_HorizGlueS, ActiveMaterial, "ECal_HorizGlueLogical");
+
+    /* Vertical glue between ECal blocks 
+      glue running down middle of 2x2 blocks
+      □ g □
+        g
+      □ g □
+    */
+    G4VSolid* ECal_VertGlueS = new G4Box("ECal_VertGlue", ECal_Glue_XY/2., (2*ECal_Y + ECal_Glue_XY)/2., ECal_Thickness/2.);
+    G4LogicalVolume* ECal_VertGlueLV = new G4LogicalVolume(ECal_VertGlueS, ActiveMaterial, "ECal_VertGlueLogical");
+
+    // Fibers
+    // Non-sensitive cladding around each fiber
+    // Cladding is 3% the total fiber thickness, i.e. Thickness = .03*fiber diameter
+    // See documentation for exact fiber placement
+
+    G4double ECal_FiberCore_r = ECal_Fiber_r - .03*2.*ECal_Fiber_r;
+    G4bool parameterisedFibers = (fFiberPlacement == "parameterised");
+
+    // In parameterised mode the cladding is a full tube that holds the core, so that
+    // the fiber lattice is a single parameterised daughter of the ECal block.
+    // Otherwise the cladding is a hollow tube placed next to the core.
+    G4VSolid* ECal_FiberCladdingS = new G4Tubs("ECal_FiberCladdingSolid", parameterisedFibers ? 0. : ECal_FiberCore_r, ECal_Fiber_r, ECal_Thickness/2., 0.0, 360.0*deg);
+    G4LogicalVolume* ECal_FiberCladdingLV = new G4LogicalVolume(ECal_FiberCladdingS, ActiveMaterial, "ECal_FiberCladdingLogical");
+
+    // Fiber core
+    G4VSolid* ECal_FiberS = new G4Tubs("ECal_FiberSolid", 0.0, ECal_FiberCore_r, ECal_Thickness/2., 0.0, 360.0*deg);
+    G4LogicalVolume* ECal_FiberLV = new G4LogicalVolume(ECal_FiberS, ActiveMaterial, "ECal_FiberLogical");
+
+    G4int num_fibers_block = 0;
+    if(mixtureECal)
+    {
+      // Homogenised blocks have no fibers, the whole block is sensitive
+    }
+    else if(parameterisedFibers)
+    {
+      auto ECal_FiberParam = new ECalFiberParameterisation(ECal_Fiber_Rows, ECal_Fiber_Cols,
+                                                           ECal_Fiber_XPitch, ECal_Fiber_YPitch,
+                                                           ECal_Fiber_X0, ECal_Fiber_Y0);
+      new G4PVPlacement(0, G4ThreeVector(), ECal_FiberLV, "ECal_FiberPhysical", ECal_FiberCladdingLV, false, 0, fCheckOverlaps);
+      new G4PVParameterised("ECal_FiberCladdingPhysical", ECal_FiberCladdingLV, ECalLV,
+                            kUndefined, ECal_FiberParam->GetNumberOfFibers(), ECal_FiberParam, fCheckOverlaps);
+      num_fibers_block = ECal_FiberParam->GetNumberOfFibers();
+
+      // Hand the block contents to ECalLatticeNavigation, see ConstructSDandField()
+      if(fFiberNavigation == "lattice") ECalLV->ChangeDaughtersType(kExternal);
+    }
+    else
+    {
+      for(G4int fiber_i = 0; fiber_i < ECal_Fiber_Rows; fiber_i++)
+      {
+        G4double x0 = ECal_Fiber_X0;
+        if(fiber_i % 2 != 0) x0 -= ECal_Fiber_XPitch/2.;
+        G4double y0 = ECal_Fiber_Y0 - fiber_i*ECal_Fiber_YPitch;
+
+        for(G4int fiber_j = 0; fiber_j < ECal_Fiber_Cols; fiber_j++)
+        {
+          G4int fiberNo = fiber_i*ECal_Fiber_Cols + fiber_j;
+          new G4PVPlacement(0, G4ThreeVector(x0 - fiber_j*ECal_Fiber_XPitch, y0, 0), ECal_FiberCladdingLV, "ECal_FiberCladdingPhysical", ECalLV, false, fiberNo, false);
+          new G4PVPlacement(0, G4ThreeVector(x0 - fiber_j*ECal_Fiber_XPitch, y0, 0), ECal_FiberLV, "ECal_FiberPhysical", ECalLV, false, fiberNo, false);
+          num_fibers_block++;
+        }
+      }
+    }
+    G4cout<<"Number of fibers in each ECal block: "<<num_fibers_block<<G4endl;
+
+    // Mixed ECal: homogenised blocks away from the beam impact point, sharing the block solid
+    G4LogicalVolume* ECalMixtureLV = nullptr;
+    if(fECalMode == "mixed") ECalMixtureLV = new G4LogicalVolume(ECalS, ECalMixtureMaterial, "ECalMixtureLogical");
+
+    // Mixture blocks leave the fiber volumes unplaced, they are listed to be deleted with the rest
+    fECalVolumes = {ECalLV, ECal_HorizGlueLV, ECal_VertGlueLV, ECal_FiberCladdingLV, ECal_FiberLV, ECalMixtureLV};
+  }
+
   // // ECal Blocks
+  fProfiler->Begin("ecal blocks");
   // // First ECal block has origin at ((-2.*HCal_X + ECal_X/2. + Clearance_Gap), (2.*HCal_Y - ECal_Y/2. - Clearance_Gap)), which is top right HCal block shifted by clearance gap
-  G4LogicalVolume* ECalLV[NumECalBlocks][NumECalBlocks];
-  G4VSolid* ECalS = new G4Box("ECalSolid", ECal_X/2., ECal_Y/2., ECal_Thickness/2.);
+  auto ECalLV = fECalVolumes[0];
+  auto ECalMixtureLV = fECalVolumes[5];
+
+  // Mixed ECal: blocks reaching within the detail radius of the impact point keep their fibers
+  auto ECalBlockDetailed = [&](G4double x, G4double y)
+  {
+    G4double nearX = std::max(0., std::abs(x - fECalDetailX) - ECal_X/2.);
+    G4double nearY = std::max(0., std::abs(y - fECalDetailY) - ECal_Y/2.);
+    return std::hypot(nearX, nearY) <= fECalDetailRadius;
+  };
 
+  // A 2x2 group of blocks with its glue is placed or left out as a whole
+  auto ECalGroupInEndcap = [&](G4int group_i, G4int group_j)
+  {
+    G4double x = -ECal_Offset*HCal_X + Clearance_Gap + ECal_X + ECal_Glue_XY/2. + group_i*HCal_X;
+    G4double y = ECal_Offset*HCal_Y - Clearance_Gap - ECal_Y - ECal_Glue_XY/2. - group_j*HCal_Y;
+    return InEndcap(x, y, ECal_X + ECal_Glue_XY/2., ECal_Y + ECal_Glue_XY/2.);
+  };
+
+  G4int num_blocks = 0;
+  G4int num_fiber_blocks = 0;
   for(G4int i = 0; i < NumECalBlocks; i++)
   {
     for(G4int j = 0; j < NumECalBlocks; j++)
     {
-      sprintf(nameHolder, "ECalLogical%d%d", i, j);
-      ECalLV[i][j] = new G4LogicalVolume(ECalS, ECalAbsorberMaterial, nameHolder);
-
-      G4double x0 = -2.*HCal_X + ECal_X/2. + Clearance_Gap; // Top right HCal block
+      if(!ECalGroupInEndcap(i/2, j/2)) continue;
+      G4double x0 = -ECal_Offset*HCal_X + ECal_X/2. + Clearance_Gap; // Top right HCal block
       if(i % 2 != 0) x0 += (ECal_X + ECal_Glue_XY);        // Block to the left of the first block
-      G4double y0 = 2.*HCal_Y - ECal_Y/2. - Clearance_Gap; // Top right HCal block
+      G4double y0 = ECal_Offset*HCal_Y - ECal_Y/2. - Clearance_Gap; // Top right HCal block
       if(j % 2 != 0) y0 -= (ECal_Y + ECal_Glue_XY);       // Block below the first block
       G4int i_factor = i/2;
       G4int j_factor = j/2;
-      sprintf(nameHolder, "ECalPhysical%d%d", i, j);
       // Placement implemented by taking first two blocks and then skipping down by HCal lengths
-      new G4PVPlacement(0, G4ThreeVector( x0 + i_factor*HCal_X,  y0 - j_factor*HCal_Y, 0),
-               ECalLV[i][j], nameHolder, WorldLV, false, 0, fCheckOverlaps);
-      G4cout<<"("<<i<<", "<<j<<"): "<<"("<<x0 + i_factor*HCal_X<<", "<<y0 - j_factor*HCal_Y<<")"<<G4endl;
-
+      G4ThreeVector position(x0 + i_factor*HCal_X, y0 - j_factor*HCal_Y, 0);
+      G4bool detailed = !ECalMixtureLV || ECalBlockDetailed(position.x(), position.y());
+      new G4PVPlacement(0, position, detailed ? ECalLV : ECalMixtureLV, "ECalPhysical", WorldLV, false, CellID::CopyNumber(i, j), fCheckOverlaps);
+      num_blocks++;
+      if(detailed) num_fiber_blocks++;
     }
   }
+  G4cout<<"Number of ECal blocks: "<<num_blocks<<G4endl;
+  if(ECalMixtureLV) G4cout<<"Number of ECal blocks with fibers: "<<num_fiber_blocks<<G4endl;
 
   // Every 2x2 blocks has glue in the middle
-
-  /* Horizontal glue between ECal blocks 
-    □ □
-    g g
-    □ □
-  */
-  G4LogicalVolume* ECal_HorizGlueLV[NumECalBlocks][NumECalBlocks/2]; 
-  G4VSolid* ECal_HorizGlueS = new G4Box("ECal_HorizGlueSolid", ECal_X/2., ECal_Glue_XY/2., ECal_Thickness/2.);
+  fProfiler->Begin("ecal glue");
+  auto ECal_HorizGlueLV = fECalVolumes[1];
+  auto ECal_VertGlueLV = fECalVolumes[2];
 
   for(G4int i = 0; i < NumECalBlocks; i++)
   {
     for(G4int j = 0; j < NumECalBlocks/2; j ++)
     {
-      sprintf(nameHolder, "ECal_HorizGlueLogical%d%d", i, j);
-      ECal_HorizGlueLV[i][j] = new G4LogicalVolume(ECal_HorizGlueS, ActiveMaterial, nameHolder);
-      G4double x0 = -2.*HCal_X + ECal_X/2. + Clearance_Gap;
+      if(!ECalGroupInEndcap(i/2, j)) continue;
+      G4double x0 = -ECal_Offset*HCal_X + ECal_X/2. + Clearance_Gap;
       if(i % 2 != 0) x0 += (ECal_X + ECal_Glue_XY);
-      G4double y0 = 2.*HCal_Y - ECal_Y - Clearance_Gap - ECal_Glue_XY/2.;
+      G4double y0 = ECal_Offset*HCal_Y - ECal_Y - Clearance_Gap - ECal_Glue_XY/2.;
       G4int i_factor = i/2;
-      sprintf(nameHolder, "ECal_HorizGluePhysical%d%d", i, j);
-      new G4PVPlacement(0, G4ThreeVector(x0 + i_factor*HCal_X, y0 - j*HCal_Y, 0), ECal_HorizGlueLV[i][j], nameHolder, WorldLV, false, 0, fCheckOverlaps);
+      new G4PVPlacement(0, G4ThreeVector(x0 + i_factor*HCal_X, y0 - j*HCal_Y, 0), ECal_HorizGlueLV, "ECal_HorizGluePhysical", WorldLV, false, i*NumECalBlocks/2 + j, fCheckOverlaps);
     } 
   }
 
-    /* Vertical glue between ECal blocks 
-    glue running down middle of 2x2 blocks
-    □ g □
-      g
-    □ g □
-  */
-
-  G4LogicalVolume* ECal_VertGlueLV[NumECalBlocks/2][NumECalBlocks/2];
-  G4VSolid* ECal_VertGlueS = new G4Box("ECal_VertGlue", ECal_Glue_XY/2., (2*ECal_Y + ECal_Glue_XY)/2., ECal_Thickness/2.);
-
   for(G4int i = 0; i < NumECalBlocks/2; i++)
   {
     for(G4int j = 0; j < NumECalBlocks/2; j++)
     {
-      sprintf(nameHolder, "ECal_VertGlueLogical%d%d", i, j);
-      ECal_VertGlueLV[i][j] = new G4LogicalVolume(ECal_VertGlueS, ActiveMaterial, nameHolder);
-      G4double x0 = -2.*HCal_X + ECal_X + Clearance_Gap + ECal_Glue_XY/2.;
-      G4double y0 = 2.*HCal_Y - ECal_Y - Clearance_Gap - ECal_Glue_XY/2.;
-      sprintf(nameHolder, "ECal_VertGluePhysical%d%d", i, j);
-      new G4PVPlacement(0, G4ThreeVector(x0 + i*HCal_X, y0 - j*HCal_Y, 0), ECal_VertGlueLV[i][j], nameHolder, WorldLV, false, 0, fCheckOverlaps);
+      if(!ECalGroupInEndcap(i, j)) continue;
+      G4double x0 = -ECal_Offset*HCal_X + ECal_X + Clearance_Gap + ECal_Glue_XY/2.;
+      G4double y0 = ECal_Offset*HCal_Y - ECal_Y - Clearance_Gap - ECal_Glue_XY/2.;
+      new G4PVPlacement(0, G4ThreeVector(x0 + i*HCal_X, y0 - j*HCal_Y, 0), ECal_VertGlueLV, "ECal_VertGluePhysical", WorldLV, false, i*NumECalBlocks/2 + j, fCheckOverlaps);
     } 
   }
 
-  // Fibers
-  // Non-sensitive cladding around each fiber
-  // Cladding is 3% the total fiber thickness, i.e. Thickness = .03*fiber diameter
-  // See documentation for exact fiber placement
-
-  // Fiber layers
-  //const double edge_height = 0.460 + 0.820/2.;
-  //G4VSolid* ECalEdgeLayerS = new G4Box("ECalEdgeLayerSolid", ECal_X/2., edge_height/2., ECal_Thickness/2.);
-  //G4LogicalVolume* ECalTopLayerLV = new G4LogicalVolume(ECalEdgeLayerS, ECalAbsorberMaterial, "ECalTopLayerLogical");
-  //G4LogicalVolume* ECalBottomLayerLV = new G4LogicalVolume(ECalEdgeLayerS, ECalAbsorberMaterial, "ECalBottomLayerLogical");
-  //G4AssemblyVolume* ECalTopLayerLV = new G4AssemblyVolume();
-  //G4AssemblyVolume* ECalBottomLayerLV = new G4AssemblyVolume();
-
-  //G4VSolid* ECalLayerS = new G4Box("ECalLayerSolid", ECal_X/2., 0.820/2., ECal_Thickness/2.);
-  //G4LogicalVolume* ECalLayerLV[2];
-  //ECalLayerLV[0] = new G4LogicalVolume(ECalLayerS, ECalAbsorberMaterial, "ECalEvenLayerLogical");
-  //ECalLayerLV[1] = new G4LogicalVolume(ECalLayerS, ECalAbsorberMaterial, "ECalOddLayerLogical");
-  //G4AssemblyVolume* ECalLayerLV[2];
-  //ECalLayerLV[0] = new G4AssemblyVolume();
-  //ECalLayerLV[1] = new G4AssemblyVolume();
-
-  G4LogicalVolume* ECal_FiberCladdingLV[NumECalBlocks][NumECalBlocks];
-  G4VSolid* ECal_FiberCladdingS = new G4Tubs("ECal_FiberCladdingSolid", ECal_Fiber_r - .03*2.*ECal_Fiber_r, ECal_Fiber_r, ECal_Thickness/2., 0.0, 360.0*deg);
-
-  // Fiber core
-  G4LogicalVolume* ECal_FiberLV[NumECalBlocks][NumECalBlocks];
-  G4VSolid* ECal_FiberS = new G4Tubs("ECal_FiberSolid", 0.0, ECal_Fiber_r - .03*2.*ECal_Fiber_r, ECal_Thickness/2., 0.0, 360.0*deg);
-  
-  for(G4int i = 0; i < NumECalBlocks; i++)
-  {
-    for(G4int j = 0; j < NumECalBlocks; j++)
-    {
-      sprintf(nameHolder, "ECal_FiberCladdingLogical%d%d", i, j);
-      ECal_FiberCladdingLV[i][j] = new G4LogicalVolume(ECal_FiberCladdingS, ActiveMaterial, nameHolder);
-      sprintf(nameHolder, "ECal_FiberLogical%d%d", i, j);
-      ECal_FiberLV[i][j] = new G4LogicalVolume(ECal_FiberS, ActiveMaterial, nameHolder);
-      G4int num_fibers_block = 0;
+  G4cout<<"Finished Geometry construction."<<G4endl;
+            
+  fProfiler->Begin("vis attributes");
+  SetVisAttributes();
+  DefineRegions();
+  fProfiler->Begin("cache save");
+  cache.Save(worldPV);
 
-      for(G4int fiber_i = 0; fiber_i < ECal_Fiber_Rows; fiber_i++)
-      {
-        G4double fiber_xspacing = 0.95865;
-        G4double x0 = ECal_X/2. - 0.23966;
-        if(fiber_i % 2 != 0) x0 -= fiber_xspacing/2.;
-        G4double y0 = (ECal_Y/2. - 0.46) - fiber_i*0.820;
-
-        //G4LogicalVolume *ECalLayerMotherLV;
-        //G4AssemblyVolume *ECalLayerMotherLV;
-        //double yshift;
-        //sprintf(nameHolder, "ECal_LayerPhysical%02d%02d%02d", i, j, fiber_i);
-        //if(fiber_i == 0)
-        //{
-        //  G4ThreeVector trans(0, ECal_Y/2. - edge_height/2., 0);
-        //  new G4PVPlacement(0, trans, ECalTopLayerLV, nameHolder, ECalLV[i][j], false, 0, false);
-        //  //ECalTopLayerLV->MakeImprint(ECalLV[i][j], trans, 0);
-        //  yshift = -edge_height/2. + 0.820/2.;
-        //  ECalLayerMotherLV = ECalTopLayerLV;
-        //}
-        //else if(fiber_i == ECal_Fiber_Rows - 1)
-        //{
-        //  G4ThreeVector trans(0, -ECal_Y/2. + edge_height/2., 0);
-        //  new G4PVPlacement(0, trans, ECalBottomLayerLV, nameHolder, ECalLV[i][j], false, 0, false);
-        //  //ECalBottomLayerLV->MakeImprint(ECalLV[i][j], trans, 0);
-        //  yshift = edge_height/2. - 0.820/2.;
-        //  ECalLayerMotherLV = ECalBottomLayerLV;
-        //}
-        //else
-        //{
-        //  G4ThreeVector trans(0, y0, 0);
-        //  new G4PVPlacement(0, trans, ECalLayerLV[fiber_i%2], nameHolder, ECalLV[i][j], false, 0, false);
-        //  //ECalLayerLV[fiber_i%2]->MakeImprint(ECalLV[i][j], trans, 0);
-        //  yshift = 0.;
-        //  ECalLayerMotherLV = ECalLayerLV[fiber_i%2];
-        //}
-
-        //if (fiber_i < 3 || fiber_i == ECal_Fiber_Rows - 1)
-        //  for(G4int fiber_j = 0; fiber_j < ECal_Fiber_Cols; fiber_j++)
-        //  {
-        //    G4ThreeVector trans(x0 - fiber_j*fiber_xspacing, yshift, 0);
-
-        //    sprintf(nameHolder, "ECal_FiberCladdingPhysical%02d%02d%02d%02d", i, j, fiber_i, fiber_j);
-        //    new G4PVPlacement(0, trans, ECal_FiberCladdingLV[i][j], nameHolder, ECalLayerMotherLV, false, 0, false);
-        //    //ECalLayerMotherLV->AddPlacedVolume(ECal_FiberCladdingLV[i][j], trans, 0);
-
-        //    sprintf(nameHolder, "ECal_FiberPhysical%02d%02d%02d%02d", i, j, fiber_i, fiber_j);
-        //    new G4PVPlacement(0, trans, ECal_FiberLV[i][j], nameHolder, ECalLayerMotherLV, false, 0, false);
-        //    //ECalLayerMotherLV->AddPlacedVolume(ECal_FiberLV[i][j], trans, 0);
-        //  }
-        //num_fibers_block += ECal_Fiber_Cols;
+  fWorldPV = worldPV;
+  fWorldKey = WorldKey.str();
+  fHCalKey = HCalKey.str();
+  fECalKey = ECalKey.str();
 
-        for(G4int fiber_j = 0; fiber_j < ECal_Fiber_Cols; fiber_j++)
-        {
-          sprintf(nameHolder, "ECal_FiberCladdingPhysical%02d%02d%02d%02d", i, j, fiber_i, fiber_j);
-          new G4PVPlacement(0, G4ThreeVector(x0 - fiber_j*fiber_xspacing, y0, 0), ECal_FiberCladdingLV[i][j], nameHolder, ECalLV[i][j], false, 0, false);
+  // Always return the physical World
+  return worldPV;
+}
 
-          sprintf(nameHolder, "ECal_FiberPhysical%02d%02d%02d%02d", i, j, fiber_i, fiber_j);
-          new G4PVPlacement(0, G4ThreeVector(x0 - fiber_j*fiber_xspacing, y0, 0), ECal_FiberLV[i][j], nameHolder, ECalLV[i][j], false, 0, false);
-          num_fibers_block++;
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-          // if(i == 4 && j == 3 && fiber_i == ECal_Fiber_Rows-1) std::cout<<fiber_j<<": ("<<(x0 - fiber_j*fiber_xspacing )<<", "<<y0<<")"<<std::endl;
-        }
-      }
-      G4cout<<"Number of fibers in ECal block ("<<i<<", "<<j<<"): "<<num_fibers_block<<G4endl;
-    }
-  }
+void DetectorConstruction::SetVisAttributes()
+{
+  // Volumes are looked up by name, so this also works for a geometry read from the cache
+  auto store = G4LogicalVolumeStore::GetInstance();
+  auto setVis = [store](const G4String& name, const G4VisAttributes& visAtt)
+  {
+    auto lv = store->GetVolume(name, false);
+    if(lv) lv->SetVisAttributes(visAtt);
+  };
 
-  G4cout<<"Finished Geometry construction."<<G4endl;
-            
   //Visualization attributes
   G4VisAttributes invis=G4VisAttributes::Invisible;
   G4VisAttributes* RedVisAtt= new G4VisAttributes(G4Colour(1,0,0));//red
@@ -479,119 +1562,155 @@ G4VPhysicalVolume* DetectorConstruction::DefineVolumes()
   MagentaVisAtt->SetForceSolid(true);
   // BlueVisAtt->SetForceSolid(true);
   
-  WorldLV->SetVisAttributes(G4VisAttributes::Invisible);
+  setVis("WorldLogical", G4VisAttributes::Invisible);
 
   // GreenVisAtt->SetForceSolid(true);
 
-  // Only HCal towers, ECal blocks, ECal glue, and one block's fibers are drawn
+  // Only HCal towers, ECal blocks and ECal glue are drawn
   // Change invis to other colors to see them
-  // Warning: Drawing all the fibers slows down the visualization a lot
-  for(int i=0;i<NumHCalTowers;i++)
-  {
-      for(int j=0;j<NumHCalTowers;j++)
-      {
-        HCalLV[i][j]->SetVisAttributes(RedVisAtt);
-        HCalLayerHolderLV[i][j]->SetVisAttributes(GrayVisAtt);
-    
-        if( i == 0 && j == 0) 
-        {
-          HCalActiveLV[i][j]->SetVisAttributes(invis);
-          HCalAbsorberLV[i][j]->SetVisAttributes(invis);
-          HCalLayerLV[i][j]->SetVisAttributes(invis);
-        }
-        else if( i == 0 && j == 1)
-        {
-          HCalActiveLV[i][j]->SetVisAttributes(invis);
-          HCalAbsorberLV[i][j]->SetVisAttributes(invis);
-          HCalLayerLV[i][j]->SetVisAttributes(invis);
-        }
-        else if (i == 0 && j == 2)
-        {
-          HCalActiveLV[i][j]->SetVisAttributes(invis);
-          HCalAbsorberLV[i][j]->SetVisAttributes(invis);
-          HCalLayerLV[i][j]->SetVisAttributes(invis);
-        }
-        else
-        {
-          HCalActiveLV[i][j]->SetVisAttributes(invis);
-          HCalAbsorberLV[i][j]->SetVisAttributes(invis);
-          HCalLayerLV[i][j]->SetVisAttributes(invis);
-        }
-        if(i != NumHCalTowers-1) HCalWLS_LV[i][j]->SetVisAttributes(invis);
-        if(j != NumHCalTowers - 1) HCalSteelLV[i][j]->SetVisAttributes(invis);
-      }
-      
-  }
+  // Warning: Drawing all the fibers slows down the visualization a lot,
+  // /athena/vis/lod draws them for a few blocks only (VisLevelOfDetail)
+  setVis("HCalLogical", *RedVisAtt);
+  setVis("HCalLogical_WLS", *RedVisAtt);
+  setVis("HCalLogical_Steel", *RedVisAtt);
+  setVis("HCalLogical_WLS_Steel", *RedVisAtt);
+  setVis("HCalLayerHolderLogical", *GrayVisAtt);
+  setVis("HCalActiveLogical", invis);
+  setVis("HCalAbsorberLogical", invis);
+  setVis("HCalLayerLogical", invis);
+  setVis("HCalWLSLogical", invis);
+  setVis("HCalSteelLogical", invis);
+
+  setVis("ECalLogical", *BlueVisAtt);
+  setVis("ECalMixtureLogical", *BlueVisAtt);
+  setVis("ECal_HorizGlueLogical", invis);
+  setVis("ECal_VertGlueLogical", invis);
+  setVis("ECal_FiberCladdingLogical", invis);
+  setVis("ECal_FiberLogical", invis);
+}
 
-  //ECalLV->SetVisAttributes(BlueVisAtt);
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-  for(G4int i = 0; i < NumECalBlocks; i++)
+void DetectorConstruction::DefineRegions()
+{
+  // Regions outlive the volumes: a rebuilt geometry is added to the existing
+  // regions, whose deleted root volumes have already been removed.
+  // Volumes are looked up by name, so this also works for a geometry read from the cache.
+  auto lvStore = G4LogicalVolumeStore::GetInstance();
+  auto addRegion = [lvStore](const G4String& regionName, const std::vector<G4String>& volumeNames)
   {
-    for(G4int j = 0; j < NumECalBlocks; j++)
+    auto region = G4RegionStore::GetInstance()->GetRegion(regionName, false);
+    if(!region) region = new G4Region(regionName);
+    for(const auto& name : volumeNames)
     {
-      ECalLV[i][j]->SetVisAttributes(BlueVisAtt);
-      if(j <4) ECal_HorizGlueLV[i][j]->SetVisAttributes(invis);
-      if(i < 4 && j < 4) ECal_VertGlueLV[i][j]->SetVisAttributes(invis);
-
-      if(i >4 && j > 4)
-      {
-        ECal_FiberCladdingLV[i][j]->SetVisAttributes(invis);
-        ECal_FiberLV[i][j]->SetVisAttributes(invis);
-      }
-      else
-      {
-        ECal_FiberCladdingLV[i][j]->SetVisAttributes(invis);
-        ECal_FiberLV[i][j]->SetVisAttributes(invis);
-      }
+      auto lv = lvStore->GetVolume(name, false);
+      if(lv) region->AddRootLogicalVolume(lv);
     }
+  };
+
+  // Fibers and cladding are daughters of the blocks and inherit their region
+  addRegion("ECal", {"ECalLogical", "ECalMixtureLogical", "ECal_HorizGlueLogical", "ECal_VertGlueLogical"});
+  addRegion("HCalAbsorber", {"HCalAbsorberLogical"});
+  addRegion("HCalActive", {"HCalActiveLogical"});
+  addRegion("Passive", {"HCalWLSLogical", "HCalSteelLogical"});
+
+  SetRegionCut("ECal", fECalCut);
+  SetRegionCut("HCalAbsorber", fHCalAbsorberCut);
+  SetRegionCut("HCalActive", fHCalActiveCut);
+  SetRegionCut("Passive", fPassiveCut);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetRegionCut(const G4String& regionName, G4double cut)
+{
+  // Before the first construction the cut is applied by DefineRegions()
+  auto region = G4RegionStore::GetInstance()->GetRegion(regionName, false);
+  if(!region) return;
+
+  if(cut <= 0.)
+  {
+    // Share the default cuts, so the region follows /run/setCut
+    region->SetProductionCuts(G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts());
+    return;
   }
 
-  // Always return the physical World
-  return worldPV;
+  auto cuts = region->GetProductionCuts();
+  if(!cuts || cuts == G4ProductionCutsTable::GetProductionCutsTable()->GetDefaultProductionCuts())
+  {
+    cuts = new G4ProductionCuts;
+    region->SetProductionCuts(cuts);
+  }
+  cuts->SetProductionCut(cut);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 void DetectorConstruction::ConstructSDandField()
 {
+  // Workers share this object, only the master is profiled
+  G4bool profile = G4Threading::IsMasterThread();
+  if(profile) fProfiler->Begin("sd and field");
+
   G4SDManager::GetSDMpointer()->SetVerboseLevel(0);
 
-  char HitsNameHolder[200];
-  char SDNameHolder[200];
-  char DetectorNameHolder[200];
+  // One SD per subsystem. Towers and blocks are placed with copy number
+  // CellID::CopyNumber(i, j), which the SD decodes into the cell and its CellID.
 
-  CalorimeterSD* HCalSD[NumHCalTowers][NumHCalTowers];
-    
-  for(G4int i = 0; i < NumHCalTowers; i++)
+  // SDs are reused when the geometry is re-initialised, e.g. by /athena/geometry/ecalMode
+  auto sdManager = G4SDManager::GetSDMpointer();
+  auto HCalSD = static_cast<CalorimeterSD*>(sdManager->FindSensitiveDetector("HCalSD", false));
+  auto ECalSD = static_cast<CalorimeterSD*>(sdManager->FindSensitiveDetector("ECalSD", false));
+  auto unifiedSD = static_cast<UnifiedCalorimeterSD*>(sdManager->FindSensitiveDetector("CalorimeterSD", false));
+
+  if(fUnifiedSD)
   {
-    for(G4int j = 0; j < NumHCalTowers; j++)
-    { 
-      sprintf(SDNameHolder, "HCalSD%d%d", i, j);
-      sprintf(HitsNameHolder, "HCalHitsCollection%d%d", i, j);
-      sprintf(DetectorNameHolder, "HCalActiveLogical%d%d", i, j);
-
-      HCalSD[i][j] = new CalorimeterSD(SDNameHolder, HitsNameHolder, NumHCalLayers);
-      G4SDManager::GetSDMpointer()->AddNewDetector(HCalSD[i][j]);
-      SetSensitiveDetector(DetectorNameHolder, HCalSD[i][j]);
+    if(!unifiedSD)
+    {
+      unifiedSD = new UnifiedCalorimeterSD("CalorimeterSD");
+      sdManager->AddNewDetector(unifiedSD);
     }
+    for(auto lv : ConfigureUnifiedSD(unifiedSD)) AttachSD(lv, unifiedSD);
   }
-
-  //CalorimeterSD* ECalSD = new CalorimeterSD("ECalSD", "ECalHitsCollection", 1);
-  //G4SDManager::GetSDMpointer()->AddNewDetector(ECalSD);
-  //SetSensitiveDetector("ECalLogical", ECalSD);
-
-  CalorimeterSD* ECalSD[NumECalBlocks][NumECalBlocks];
-  for(G4int i = 0; i < NumECalBlocks; i++)
+  else
   {
-    for(G4int j = 0; j < NumECalBlocks; j++)
+    if(!HCalSD)
     {
-      sprintf(SDNameHolder, "ECalSD%d%d", i, j);
-      sprintf(HitsNameHolder, "ECalHitsCollection%d%d", i, j);
-      sprintf(DetectorNameHolder, "ECal_FiberLogical%d%d", i, j);
+      HCalSD = NewHCalSD("HCalSD", "HCalHitsCollection");
+      sdManager->AddNewDetector(HCalSD);
+    }
+    for(auto lv : ConfigureHCalSD(HCalSD)) AttachSD(lv, HCalSD);
 
-      ECalSD[i][j] = new CalorimeterSD(SDNameHolder, HitsNameHolder, 1);
-      G4SDManager::GetSDMpointer()->AddNewDetector(ECalSD[i][j]);
-      SetSensitiveDetector(DetectorNameHolder, ECalSD[i][j]);
+    //CalorimeterSD* ECalSD = new CalorimeterSD("ECalSD", "ECalHitsCollection", 1);
+    //G4SDManager::GetSDMpointer()->AddNewDetector(ECalSD);
+    //SetSensitiveDetector("ECalLogical", ECalSD);
+
+    if(!ECalSD)
+    {
+      ECalSD = NewECalSD("ECalSD", "ECalHitsCollection");
+      sdManager->AddNewDetector(ECalSD);
     }
+    for(auto lv : ConfigureECalSD(ECalSD)) AttachSD(lv, ECalSD);
+  }
+
+  // Only the SDs in use are initialised at each event, EventAction reads the active ones
+  if(HCalSD) HCalSD->Activate(!fUnifiedSD);
+  if(ECalSD) ECalSD->Activate(!fUnifiedSD);
+  if(unifiedSD) unifiedSD->Activate(fUnifiedSD);
+
+  // Lattice navigation of the ECal fibers.
+  // Installed here because the tracking navigator is per thread. The instance of
+  // the previous construction refers to its volumes, so it is always replaced.
+  auto navigator = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking();
+  navigator->SetExternalNavigation(nullptr);
+  delete fLatticeNavigation;
+  fLatticeNavigation = nullptr;
+  auto ECalLV = G4LogicalVolumeStore::GetInstance()->GetVolume("ECalLogical");
+  if(ECalLV->CharacteriseDaughters() == kExternal)
+  {
+    auto fiberPV = ECalLV->GetDaughter(0);
+    auto fiberParam = static_cast<ECalFiberParameterisation*>(fiberPV->GetParameterisation());
+    fLatticeNavigation = new ECalLatticeNavigation(fiberPV, fiberParam);
+    navigator->SetExternalNavigation(fLatticeNavigation);
   }
 
   // Magnetic field
@@ -599,12 +1718,169 @@ void DetectorConstruction::ConstructSDandField()
   // Create global magnetic field messenger.
   // Uniform magnetic field is then created automatically if
   // the field value is not zero.
-  G4ThreeVector fieldValue;
-  fMagFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
-  fMagFieldMessenger->SetVerboseLevel(0);
+  if(!fMagFieldMessenger) // already created before a geometry re-initialisation
+  {
+    G4ThreeVector fieldValue;
+    fMagFieldMessenger = new G4GlobalMagFieldMessenger(fieldValue);
+    fMagFieldMessenger->SetVerboseLevel(0);
   
-  // Register the field messenger for deleting
-  G4AutoDelete::Register(fMagFieldMessenger);
+    // Register the field messenger for deleting
+    G4AutoDelete::Register(fMagFieldMessenger);
+  }
 
+  if(profile) fProfiler->End();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CalorimeterSD* DetectorConstruction::NewHCalSD(const G4String& name, const G4String& collectionName) const
+{
+  // HCal touchable: active plate (0) / layer replica (1) / layer holder (2) / tower (3)
+  return new CalorimeterSD(name, collectionName, CellID::kHCal, NumHCalTowers, 3, 1, NumHCalLayers);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+CalorimeterSD* DetectorConstruction::NewECalSD(const G4String& name, const G4String& collectionName) const
+{
+  // The cell depth depends on the ECal mode, see ConfigureECalSD()
+  return new CalorimeterSD(name, collectionName, CellID::kECal, NumECalBlocks);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4LogicalVolume*> DetectorConstruction::ConfigureHCalSD(CalorimeterSD* sd) const
+{
+  sd->SetLayout(NumHCalTowers, NumHCalLayers);
+  sd->SetBatchSize(fSDBatchSize);
+  ConfigureQuenching(sd);
+  return { G4LogicalVolumeStore::GetInstance()->GetVolume("HCalActiveLogical") };
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int DetectorConstruction::ECalBlockDepth() const
+{
+  // ECal touchable: fiber core (0) / [cladding (1)] / block, or the block itself (0) for mixture blocks
+  // Parameterised fibers sit inside their cladding, so the block is one level further up
+  return (fECalMode == "mixture") ? 0 : (fFiberPlacement == "parameterised") ? 2 : 1;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4LogicalVolume*> DetectorConstruction::ConfigureECalSD(CalorimeterSD* sd) const
+{
+  G4bool mixtureECal = (fECalMode == "mixture");
+  sd->SetLayout(NumECalBlocks);
+  sd->SetCellDepth(ECalBlockDepth());
+  sd->SetEnergyScale(mixtureECal ? fECalSamplingFraction : 1.);
+  sd->ClearVolumeSettings();
+  sd->SetBatchSize(fSDBatchSize);
+  ConfigureQuenching(sd);
+  std::vector<G4LogicalVolume*> volumes
+    = { G4LogicalVolumeStore::GetInstance()->GetVolume(mixtureECal ? "ECalLogical" : "ECal_FiberLogical") };
+
+  // Readout granularity inside the fiber blocks. The fiber number is the copy number
+  // of the core (placements) or of the cladding (parameterised), one level below the block.
+  G4int rowsPerGroup = 0, colsPerGroup = 0;
+  if(fECalGranularity == "fiber") rowsPerGroup = colsPerGroup = 1;
+  else if(fECalGranularity == "bundle") { rowsPerGroup = fECalBundleRows; colsPerGroup = fECalBundleCols; }
+  else if(fECalGranularity == "quadrant") { rowsPerGroup = (fECalFiberRows + 1)/2; colsPerGroup = (fECalFiberCols + 1)/2; }
+  sd->SetFiberGroups(fECalFiberRows, fECalFiberCols, rowsPerGroup, colsPerGroup);
+  if(!mixtureECal) sd->SetFiberDepth(volumes[0], ECalBlockDepth() - 1);
+
+  // Light model of the fibers, read out at the back of the blocks
+  if(fFiberLightYield > 0. && !mixtureECal)
+  {
+    const G4int nofSteps = 64;
+    std::vector<G4double> attenuation(nofSteps + 1);
+    for(G4int n = 0; n <= nofSteps; n++)
+      attenuation[n] = std::exp(-n*fECalFiberLength/nofSteps/fFiberAttenuationLength);
+    sd->SetFiberResponse(fFiberLightYield, fECalFiberLength, attenuation);
+    sd->SetOpticalVolume(volumes[0]);
+  }
+  else sd->SetFiberResponse(0., 0., {});
+
+  // Mixed ECal: the homogenised blocks are their own touchable and scaled by the sampling fraction.
+  // They may all have been replaced by fiber blocks, and then are not read back from the cache.
+  auto ECalMixtureLV = G4LogicalVolumeStore::GetInstance()->GetVolume("ECalMixtureLogical", false);
+  if(fECalMode == "mixed" && ECalMixtureLV)
+  {
+    sd->SetCellDepth(ECalMixtureLV, 0);
+    sd->SetEnergyScale(ECalMixtureLV, fECalSamplingFraction);
+    volumes.push_back(ECalMixtureLV);
+  }
+  return volumes;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4LogicalVolume*> DetectorConstruction::ConfigureUnifiedSD(UnifiedCalorimeterSD* sd) const
+{
+  // Same cells, depths and energy scales as the SDs per subsystem, ECal blocks as a whole
+  if(fECalGranularity != "block")
+  {
+    G4ExceptionDescription msg;
+    msg << "The unified SD reads the ECal out per block, ecalGranularity " << fECalGranularity << " is ignored.";
+    G4Exception("DetectorConstruction::ConfigureUnifiedSD()",
+      "MyCode0022", JustWarning, msg);
+  }
+  if(fFiberLightYield > 0.)
+  {
+    G4ExceptionDescription msg;
+    msg << "The unified SD has no fiber light model, fiberLightYield " << fFiberLightYield
+        << " is ignored and the ECal_Npe columns stay 0.";
+    G4Exception("DetectorConstruction::ConfigureUnifiedSD()",
+      "MyCode0022", JustWarning, msg);
+  }
+  sd->SetLayout(CellID::kHCal, NumHCalTowers, NumHCalLayers);
+  sd->SetLayout(CellID::kECal, NumECalBlocks);
+  sd->ClearVolumes();
+  ConfigureQuenching(sd);
+
+  auto lvStore = G4LogicalVolumeStore::GetInstance();
+  auto HCalActiveLV = lvStore->GetVolume("HCalActiveLogical");
+  sd->AddVolume(HCalActiveLV, CellID::kHCal, 3, 1);
+
+  G4bool mixtureECal = (fECalMode == "mixture");
+  auto ECalLV = lvStore->GetVolume(mixtureECal ? "ECalLogical" : "ECal_FiberLogical");
+  sd->AddVolume(ECalLV, CellID::kECal, ECalBlockDepth(), -1, mixtureECal ? fECalSamplingFraction : 1.);
+  std::vector<G4LogicalVolume*> volumes = { HCalActiveLV, ECalLV };
+
+  auto ECalMixtureLV = lvStore->GetVolume("ECalMixtureLogical", false);
+  if(fECalMode == "mixed" && ECalMixtureLV)
+  {
+    sd->AddVolume(ECalMixtureLV, CellID::kECal, 0, -1, fECalSamplingFraction);
+    volumes.push_back(ECalMixtureLV);
+  }
+  return volumes;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::AttachSD(G4LogicalVolume* lv, G4VSensitiveDetector* sd)
+{
+  // Kept volumes may carry the SD of the other mode, which would be combined with this one
+  if(lv->GetSensitiveDetector() == sd) return;
+  lv->SetSensitiveDetector(nullptr);
+  SetSensitiveDetector(lv, sd);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::SetUnifiedSD(G4bool flag)
+{
+  if(flag == fUnifiedSD) return;
+  fUnifiedSD = flag;
+  GeometryHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void DetectorConstruction::ReportConstruction() const
+{
+  fProfiler->SetReportFile(fProfileReport);
+  fProfiler->SetVoxelTiming(fProfileVoxels);
+  fProfiler->Report();
 }
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
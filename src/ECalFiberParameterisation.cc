@@ -0,0 +1,38 @@
+/// \file ECalFiberParameterisation.cc
+/// \brief Implementation of the ECalFiberParameterisation class
+
+#include "ECalFiberParameterisation.hh"
+#include "G4VPhysicalVolume.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ECalFiberParameterisation::ECalFiberParameterisation(
+                            G4int nRows, G4int nCols,
+                            G4double xPitch, G4double yPitch,
+                            G4double x0, G4double y0)
+ : G4VPVParameterisation(),
+   fNRows(nRows),
+   fNCols(nCols),
+   fXPitch(xPitch),
+   fYPitch(yPitch),
+   fX0(x0),
+   fY0(y0)
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ECalFiberParameterisation::~ECalFiberParameterisation()
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ECalFiberParameterisation::ComputeTransformation(
+                            const G4int copyNo, G4VPhysicalVolume* physVol) const
+{
+  physVol->SetTranslation(GetFiberPosition(copyNo / fNCols, copyNo % fNCols));
+  physVol->SetRotation(0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,272 @@
+/// \file ECalLatticeNavigation.cc
+/// \brief Implementation of the ECalLatticeNavigation class
+
+#include "ECalLatticeNavigation.hh"
+#include "ECalFiberParameterisation.hh"
+
+#include "G4NavigationHistory.hh"
+#include "G4AuxiliaryNavServices.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Tubs.hh"
+#include "G4GeometryTolerance.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+  // Same criterion as the stock navigators for not re-entering the daughter just exited
+  const G4double kMinExitingCosine = 1.e-3;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ECalLatticeNavigation::ECalLatticeNavigation(
+                            G4VPhysicalVolume* fiberPV,
+                            const ECalFiberParameterisation* param)
+ : G4VExternalNavigation(),
+   fFiberPV(fiberPV),
+   fParam(param),
+   fFiberSolid(fiberPV->GetLogicalVolume()->GetSolid()),
+   fFiberRadius(0.),
+   fMaxSafety(0.)
+{
+  auto tube = dynamic_cast<const G4Tubs*>(fFiberSolid);
+  if ( ! tube ) {
+    G4ExceptionDescription msg;
+    msg << "Fiber volume " << fiberPV->GetName() << " is not a tube.";
+    G4Exception("ECalLatticeNavigation::ECalLatticeNavigation()",
+      "MyCode0005", FatalException, msg);
+  }
+  fFiberRadius = tube->GetOuterRadius();
+
+  // Fibers outside the 3x3 neighbourhood of the nearest one are at least
+  // 1.5 pitches away from the point, minus their radius
+  fMaxSafety = 1.5*std::min(fParam->GetXPitch(), fParam->GetYPitch()) - fFiberRadius;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ECalLatticeNavigation::~ECalLatticeNavigation()
+{
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VExternalNavigation* ECalLatticeNavigation::Clone()
+{
+  return new ECalLatticeNavigation(fFiberPV, fParam);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int ECalLatticeNavigation::NearestRow(G4double y) const
+{
+  G4int row = G4int(std::floor((fParam->GetY0() - y)/fParam->GetYPitch() + 0.5));
+  return (row < 0 || row >= fParam->GetNumberOfRows()) ? -1 : row;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int ECalLatticeNavigation::NearestColumn(G4int row, G4double x) const
+{
+  G4double xRow = fParam->GetFiberPosition(row, 0).x();
+  G4int col = G4int(std::floor((xRow - x)/fParam->GetXPitch() + 0.5));
+  return (col < 0 || col >= fParam->GetNumberOfColumns()) ? -1 : col;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ECalLatticeNavigation::FiberSafety(const G4ThreeVector& localPoint) const
+{
+  G4int nRows = fParam->GetNumberOfRows();
+  G4int nCols = fParam->GetNumberOfColumns();
+
+  G4int rowC = G4int(std::floor((fParam->GetY0() - localPoint.y())/fParam->GetYPitch() + 0.5));
+  rowC = std::max(0, std::min(nRows-1, rowC));
+
+  G4double safety = fMaxSafety;
+  for(G4int row = std::max(0, rowC-1); row <= std::min(nRows-1, rowC+1); row++)
+  {
+    G4double xRow = fParam->GetFiberPosition(row, 0).x();
+    G4int colC = G4int(std::floor((xRow - localPoint.x())/fParam->GetXPitch() + 0.5));
+    colC = std::max(0, std::min(nCols-1, colC));
+
+    for(G4int col = std::max(0, colC-1); col <= std::min(nCols-1, colC+1); col++)
+    {
+      G4double sampleSafety = fFiberSolid->DistanceToIn(localPoint - fParam->GetFiberPosition(row, col));
+      if(sampleSafety < safety) safety = sampleSafety;
+    }
+  }
+  return safety;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool ECalLatticeNavigation::LevelLocate(G4NavigationHistory& history,
+                                          const G4VPhysicalVolume* blockedVol,
+                                          const G4int blockedNum,
+                                          const G4ThreeVector& /*globalPoint*/,
+                                          const G4ThreeVector* globalDirection,
+                                          const G4bool pLocatedOnEdge,
+                                          G4ThreeVector& localPoint)
+{
+  // The row pitch is larger than the fiber diameter, so only the nearest
+  // fiber of the nearest row can contain the point
+  G4int row = NearestRow(localPoint.y());
+  if ( row < 0 ) return false;
+  G4int col = NearestColumn(row, localPoint.x());
+  if ( col < 0 ) return false;
+
+  G4int fiberNo = row*fParam->GetNumberOfColumns() + col;
+  if ( blockedVol == fFiberPV && blockedNum == fiberNo ) return false;
+
+  G4ThreeVector samplePoint = localPoint - fParam->GetFiberPosition(row, col);
+  if ( fFiberSolid->Inside(samplePoint) == kOutside ) return false;
+
+  fParam->ComputeTransformation(fiberNo, fFiberPV);
+  fFiberPV->SetCopyNo(fiberNo);
+  history.NewLevel(fFiberPV, kParameterised, fiberNo);
+
+  if ( G4AuxiliaryNavServices::CheckPointOnSurface(fFiberSolid, samplePoint, globalDirection,
+                                                   history.GetTopTransform(), pLocatedOnEdge) )
+  {
+    localPoint = samplePoint;
+    return true;
+  }
+
+  history.BackLevel();
+  return false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ECalLatticeNavigation::ComputeStep(const G4ThreeVector& localPoint,
+                                            const G4ThreeVector& localDirection,
+                                            const G4double currentProposedStepLength,
+                                            G4double& newSafety,
+                                            G4NavigationHistory& history,
+                                            G4bool& validExitNormal,
+                                            G4ThreeVector& exitNormal,
+                                            G4bool& exiting,
+                                            G4bool& entering,
+                                            G4VPhysicalVolume* (*pBlockedPhysical),
+                                            G4int& blockedReplicaNo)
+{
+  G4VPhysicalVolume* motherPhysical = history.GetTopVolume();
+  G4VSolid* motherSolid = motherPhysical->GetLogicalVolume()->GetSolid();
+
+  // Block the fiber just exited if moving away from it
+  G4VPhysicalVolume* blockedExitedVol = nullptr;
+  G4int blockedExitedNo = blockedReplicaNo;
+  if ( exiting && validExitNormal && localDirection.dot(exitNormal) >= kMinExitingCosine ) {
+    blockedExitedVol = *pBlockedPhysical;
+  }
+  exiting  = false;
+  entering = false;
+
+  G4double ourStep = currentProposedStepLength;
+  G4double ourSafety = (blockedExitedVol != nullptr) ? 0.
+                       : std::min(motherSolid->DistanceToOut(localPoint), FiberSafety(localPoint));
+  newSafety = ourSafety;
+  if ( currentProposedStepLength < ourSafety ) return ourStep;
+
+  G4bool motherValidExitNormal = false;
+  G4ThreeVector motherExitNormal;
+  G4double motherStep = motherSolid->DistanceToOut(localPoint, localDirection, true,
+                                                   &motherValidExitNormal, &motherExitNormal);
+  if ( motherStep >= kInfinity || motherStep < 0. ) {
+    G4ExceptionDescription msg;
+    msg << "Point " << localPoint << " with direction " << localDirection
+        << " is not inside block " << motherPhysical->GetName() << ".";
+    G4Exception("ECalLatticeNavigation::ComputeStep()",
+      "MyCode0006", JustWarning, msg);
+    motherStep = 0.;
+  }
+
+  // Fibers crossed by the ray before it leaves the block. Rows are visited in
+  // the order the ray crosses them, so the walk stops at the first row entered
+  // beyond the closest fiber found so far.
+  const G4double R = fFiberRadius + G4GeometryTolerance::GetInstance()->GetSurfaceTolerance();
+  const G4double x = localPoint.x(), y = localPoint.y();
+  const G4double dx = localDirection.x(), dy = localDirection.y();
+  const G4double xPitch = fParam->GetXPitch(), yPitch = fParam->GetYPitch();
+  const G4int nRows = fParam->GetNumberOfRows(), nCols = fParam->GetNumberOfColumns();
+
+  G4double maxLength = std::min(ourStep, motherStep);
+  G4double yEnd = y + maxLength*dy;
+  G4int rowFirst = std::max(0, G4int(std::ceil((fParam->GetY0() - (std::max(y, yEnd) + R))/yPitch)));
+  G4int rowLast = std::min(nRows-1, G4int(std::floor((fParam->GetY0() - (std::min(y, yEnd) - R))/yPitch)));
+  G4int rowStep = (dy > 0.) ? -1 : 1; // Rows are numbered towards -y
+
+  for(G4int row = (dy > 0.) ? rowLast : rowFirst; row >= rowFirst && row <= rowLast; row += rowStep)
+  {
+    G4ThreeVector rowStart = fParam->GetFiberPosition(row, 0);
+    G4double tIn = 0., tOut = maxLength;
+    if ( dy != 0. ) {
+      G4double t1 = (rowStart.y() - R - y)/dy;
+      G4double t2 = (rowStart.y() + R - y)/dy;
+      tIn = std::max(0., std::min(t1, t2));
+      tOut = std::min(tOut, std::max(t1, t2));
+    }
+    if ( tIn > ourStep ) break;
+    tOut = std::min(tOut, ourStep);
+    if ( tIn > tOut ) continue;
+
+    G4double xa = x + tIn*dx, xb = x + tOut*dx;
+    G4int colFirst = std::max(0, G4int(std::ceil((rowStart.x() - (std::max(xa, xb) + R))/xPitch)));
+    G4int colLast = std::min(nCols-1, G4int(std::floor((rowStart.x() - (std::min(xa, xb) - R))/xPitch)));
+
+    for(G4int col = colFirst; col <= colLast; col++)
+    {
+      G4int fiberNo = row*nCols + col;
+      if ( fFiberPV == blockedExitedVol && fiberNo == blockedExitedNo ) continue;
+
+      G4ThreeVector samplePoint = localPoint - fParam->GetFiberPosition(row, col);
+      G4double sampleStep = fFiberSolid->DistanceToIn(samplePoint, localDirection);
+      if ( sampleStep <= ourStep ) {
+        ourStep = sampleStep;
+        entering = true;
+        *pBlockedPhysical = fFiberPV;
+        blockedReplicaNo = fiberNo;
+      }
+    }
+  }
+
+  if ( motherStep <= ourStep ) {
+    ourStep = motherStep;
+    exiting = true;
+    entering = false;
+    validExitNormal = motherValidExitNormal;
+    exitNormal = motherExitNormal;
+    if ( validExitNormal ) {
+      const G4RotationMatrix* rot = motherPhysical->GetRotation();
+      if ( rot ) exitNormal *= rot->inverse();
+    }
+  }
+  else {
+    validExitNormal = false;
+  }
+
+  return ourStep;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double ECalLatticeNavigation::ComputeSafety(const G4ThreeVector& localPoint,
+                                              const G4NavigationHistory& history,
+                                              const G4double /*pMaxLength*/)
+{
+  G4VSolid* motherSolid = history.GetTopVolume()->GetLogicalVolume()->GetSolid();
+  return std::min(motherSolid->DistanceToOut(localPoint), FiberSafety(localPoint));
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ECalLatticeNavigation::RelocateWithinVolume(G4VPhysicalVolume* /*motherPhysical*/,
+                                                 const G4ThreeVector& /*localPoint*/)
+{
+  // Nothing is cached between calls
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
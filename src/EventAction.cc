@@ -3,7 +3,9 @@
 /// \brief Implementation of the EventAction class
 
 #include "EventAction.hh"
+#include "RunAction.hh"
 #include "CalorimeterSD.hh"
+#include "UnifiedCalorimeterSD.hh"
 #include "CalorHit.hh"
 #include "Analysis.hh"
 #include "G4RunManager.hh"
@@ -13,12 +15,20 @@
 #include "G4UnitsTable.hh"
 #include "GlobalValues.hh"
 
+#include <map>
+#include <vector>
+
 using namespace GlobalValues;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-EventAction::EventAction()
- : G4UserEventAction()
+EventAction::EventAction(RunAction* runAction)
+ : G4UserEventAction(),
+   fRunAction(runAction),
+   fHCalHCID(-1),
+   fECalHCID(-1),
+   fECalReadoutHCID(-1),
+   fHCalReadoutHCID(-1)
 {}
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -73,95 +83,291 @@ void EventAction::EndOfEventAction(const G4Event* event)
 {  
   auto eventID = event->GetEventID();
 
-  char nameHolder[200];
   // get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
 
+  // Get hits collections IDs (only once)
+  if ( fHCalHCID == -1 ) {
+    fHCalHCID = G4SDManager::GetSDMpointer()->GetCollectionID("HCalHitsCollection");
+    fECalHCID = G4SDManager::GetSDMpointer()->GetCollectionID("ECalHitsCollection");
+    fECalReadoutHCID = G4SDManager::GetSDMpointer()->GetCollectionID("ECalReadoutHitsCollection");
+    fHCalReadoutHCID = G4SDManager::GetSDMpointer()->GetCollectionID("HCalReadoutHitsCollection");
+  }
+
+  // Ntuple with id 3 holds HCal tile information
+  auto fillTile = [analysisManager, eventID](G4int i, G4int j, G4int k, G4double edep, G4int nHits)
+  {
+    analysisManager->FillNtupleDColumn(3, 0, edep);
+    analysisManager->FillNtupleIColumn(3, 1, k);
+    analysisManager->FillNtupleIColumn(3, 2, nHits);
+    analysisManager->FillNtupleIColumn(3, 3, i);
+    analysisManager->FillNtupleIColumn(3, 4, j);
+    analysisManager->FillNtupleIColumn(3, 5, eventID);
+    analysisManager->FillNtupleDColumn(3, 6, CellID::Encode(CellID::kHCal, i, j, k));
+    analysisManager->AddNtupleRow(3);
+  };
+
+  // Ntuple with id 2 holds HCal tower information
+  auto fillTower = [analysisManager, eventID](G4int i, G4int j, G4double edep)
+  {
+    analysisManager->FillNtupleDColumn(2, 0, edep);
+    analysisManager->FillNtupleIColumn(2, 1, i);
+    analysisManager->FillNtupleIColumn(2, 2, j);
+    analysisManager->FillNtupleIColumn(2, 3, eventID);
+    analysisManager->FillNtupleDColumn(2, 4, CellID::Encode(CellID::kHCal, i, j));
+    analysisManager->AddNtupleRow(2);
+  };
+
+  // Ntuple with id 1 holds ECal information
+  auto fillBlock = [analysisManager, eventID](G4int i, G4int j, G4double edep, G4double npe)
+  {
+    analysisManager->FillNtupleDColumn(1, 0, edep);
+    analysisManager->FillNtupleIColumn(1, 1, i);
+    analysisManager->FillNtupleIColumn(1, 2, j);
+    analysisManager->FillNtupleIColumn(1, 3, eventID);
+    analysisManager->FillNtupleDColumn(1, 4, CellID::Encode(CellID::kECal, i, j));
+    analysisManager->FillNtupleDColumn(1, 5, npe);
+    analysisManager->AddNtupleRow(1);
+  };
+
+  // Ntuple with id 6 holds the ECal cells below block level (fiber groups)
+  auto fillSubCell = [analysisManager, eventID](CellID::Type id, G4double edep)
+  {
+    analysisManager->FillNtupleDColumn(6, 0, edep);
+    analysisManager->FillNtupleIColumn(6, 1, CellID::X(id));
+    analysisManager->FillNtupleIColumn(6, 2, CellID::Y(id));
+    analysisManager->FillNtupleIColumn(6, 3, CellID::Fiber(id) - 1);
+    analysisManager->FillNtupleIColumn(6, 4, eventID);
+    analysisManager->FillNtupleDColumn(6, 5, id);
+    analysisManager->AddNtupleRow(6);
+  };
+
   G4double HCal_Edep = 0.; // Total Edep for HCal
   G4int HCal_hits = 0; // Total hits for HCal
+  G4double ECal_Edep = 0.; // Total Edep for ECal
+  G4int ECal_hits = 0; // Total hits for ECal
+  G4double ECal_Npe = 0.; // Total photoelectrons for ECal, with the fiber light model
 
-  // Getting HCal information.
-  
-  for(G4int i = 0; i < NumHCalTowers; i++)
-  {
-    for(G4int j = 0; j < NumHCalTowers; j++)
+  // The unified SD (/athena/geometry/unifiedSD) holds every cell of both
+  // subsystems in flat arrays, which are scanned in cell order
+  auto unifiedSD = static_cast<UnifiedCalorimeterSD*>(
+    G4SDManager::GetSDMpointer()->FindSensitiveDetector("CalorimeterSD", false));
+  if ( unifiedSD && unifiedSD->isActive() ) {
+    auto edep = unifiedSD->GetEdep();
+    auto nHits = unifiedSD->GetNumHits();
+    std::size_t ECalBegin = unifiedSD->GetOffset(CellID::kECal);
+    std::size_t ECalEnd = ECalBegin + unifiedSD->GetNofCells(CellID::kECal);
+    for(std::size_t cell = ECalBegin; cell < ECalEnd; cell++) { ECal_Edep += edep[cell]; ECal_hits += nHits[cell]; }
+    fRunAction->AddECalEdep(ECal_Edep);
+
+    // ECal sampling-fraction calibration only needs the ECal total
+    if(ECalCalibrationRun) return;
+
+    // Cells are numbered offset + (i*NumHCalTowers + j)*NumHCalLayers + layer
+    std::size_t HCalBegin = unifiedSD->GetOffset(CellID::kHCal);
+    for(G4int i = 0; i < NumHCalTowers; i++)
+    {
+      for(G4int j = 0; j < NumHCalTowers; j++)
+      {
+        G4double HCalTowerEdep = 0.;
+        G4int HCalTowerHits = 0;
+        std::size_t towerCell = HCalBegin + (std::size_t(i)*NumHCalTowers + j)*NumHCalLayers;
+
+        for(G4int k = 0; k < NumHCalLayers; k++)
+        {
+          std::size_t cell = towerCell + k;
+          HCalTowerEdep += edep[cell];
+          HCalTowerHits += nHits[cell];
+          if(!SparseOutput || nHits[cell] > 0) fillTile(i, j, k, edep[cell], nHits[cell]);
+        }
+        if(!SparseOutput || HCalTowerHits > 0) fillTower(i, j, HCalTowerEdep);
+        HCal_Edep += HCalTowerEdep;
+        HCal_hits += HCalTowerHits;
+      }
+    }
+
+    // Cells are numbered offset + i*NumECalBlocks + j
+    for(G4int i = 0; i < NumECalBlocks; i++)
     {
-      G4double HCalTowerEdep = 0.;
-      G4int layer_tracker = 0;
-
-      sprintf(nameHolder, "HCalHitsCollection%d%d", i, j);
-      G4int HCalHCID = G4SDManager::GetSDMpointer()->GetCollectionID(nameHolder);
-      auto HCalHC = GetHitsCollection(HCalHCID, event);
-      auto HCalHit = (*HCalHC)[HCalHC->entries()-1]; // entries()-1 kept track of information for whole tower segmentation
-      HCal_Edep += HCalHit->GetEdep();
-      HCal_hits += HCalHit->GetNumHits();
-      HCalTowerEdep += HCalHit->GetEdep();
-
-      for(G4int k = 0; k < NumHCalLayers; k++)
-      { 
-        // Ntuple with id 3 holds HCal tile information
-        auto HCalTileHit = (*HCalHC)[k]; // Tile is each of scintillating plates in the HCal towers
-        analysisManager->FillNtupleDColumn(3, 0,  HCalTileHit->GetEdep());
-        analysisManager->FillNtupleIColumn(3, 1, layer_tracker);
-        analysisManager->FillNtupleIColumn(3, 2,  HCalTileHit->GetNumHits()); 
-        analysisManager->FillNtupleIColumn(3, 3, i);
-        analysisManager->FillNtupleIColumn(3, 4, j);
-        analysisManager->FillNtupleIColumn(3, 5, eventID);
-        analysisManager->AddNtupleRow(3);
-        layer_tracker++;
+      for(G4int j = 0; j < NumECalBlocks; j++)
+      {
+        std::size_t cell = ECalBegin + std::size_t(i)*NumECalBlocks + j;
+        if(!SparseOutput || nHits[cell] > 0) fillBlock(i, j, edep[cell], 0.);
       }
-      
-      // Ntuple with id 2 holds HCal tower information
-      analysisManager->FillNtupleDColumn(2, 0, HCalTowerEdep);
-      analysisManager->FillNtupleIColumn(2, 1, i);
-      analysisManager->FillNtupleIColumn(2, 2, j);
-      analysisManager->FillNtupleIColumn(2, 3, eventID);
-      analysisManager->AddNtupleRow(2);
     }
   }
+  else
+  {
+    // ECal sampling-fraction calibration only needs the ECal total
+    if(ECalCalibrationRun)
+    {
+      auto ECalHC = GetHitsCollection(fECalHCID, event);
+      fRunAction->AddECalEdep((*ECalHC)[0]->GetEdep());
+      return;
+    }
 
-  G4double ECal_Edep = 0.; // Total Edep for ECal
-  G4int ECal_hits = 0; // Total hits for ECal
+    // Entry 0 of each collection holds the sums, followed by one hit per
+    // touched cell (see CalorimeterSD). Sparse output writes only those cells,
+    // otherwise every cell is written, in (i, j, layer) order.
 
-  //G4int ECalHCID = G4SDManager::GetSDMpointer()->GetCollectionID("ECalHitsCollection");
-  //auto ECalHC = GetHitsCollection(ECalHCID, event);
-  //auto ECalHit = (*ECalHC)[ECalHC->entries()-1]; // entries()-1 kept track of information for whole block
-  //ECal_Edep += ECalHit->GetEdep();
-  //ECal_hits += ECalHit->GetNumHits();
+    // Getting HCal information.
+    auto HCalHC = GetHitsCollection(fHCalHCID, event);
+    auto HCalTotalHit = (*HCalHC)[0];
+    HCal_Edep = HCalTotalHit->GetEdep();
+    HCal_hits = HCalTotalHit->GetNumHits();
 
-  // Ntuple with id 1 holds ECal information
-  //analysisManager->FillNtupleDColumn(1, 0, ECalHit->GetEdep());
-  //analysisManager->FillNtupleIColumn(1, 1, 0);
-  //analysisManager->FillNtupleIColumn(1, 2, 0);
-  //analysisManager->FillNtupleIColumn(1, 3, eventID);
-  //analysisManager->AddNtupleRow(1);
+    if(SparseOutput)
+    {
+      std::map<CellID::Type, G4double> HCalTowerEdep; // by tower CellID
+      for(std::size_t n = 1; n < HCalHC->entries(); n++)
+      {
+        auto HCalTileHit = (*HCalHC)[n]; // Tile is each of scintillating plates in the HCal towers
+        auto id = HCalTileHit->GetCellID();
+        fillTile(CellID::X(id), CellID::Y(id), CellID::Layer(id), HCalTileHit->GetEdep(), HCalTileHit->GetNumHits());
+        HCalTowerEdep[CellID::Encode(CellID::kHCal, CellID::X(id), CellID::Y(id))] += HCalTileHit->GetEdep();
+      }
+      for(const auto& tower : HCalTowerEdep) fillTower(CellID::X(tower.first), CellID::Y(tower.first), tower.second);
+    }
+    else
+    {
+      // Cells are numbered (i*NumHCalTowers + j)*NumHCalLayers + layer
+      std::vector<const CalorHit*> HCalTiles(NumHCalTowers*NumHCalTowers*NumHCalLayers, nullptr);
+      for(std::size_t n = 1; n < HCalHC->entries(); n++)
+      {
+        auto id = (*HCalHC)[n]->GetCellID();
+        HCalTiles[(CellID::X(id)*NumHCalTowers + CellID::Y(id))*NumHCalLayers + CellID::Layer(id)] = (*HCalHC)[n];
+      }
+
+      for(G4int i = 0; i < NumHCalTowers; i++)
+      {
+        for(G4int j = 0; j < NumHCalTowers; j++)
+        {
+          G4double HCalTowerEdep = 0.;
+          G4int towerCell = (i*NumHCalTowers + j)*NumHCalLayers;
+
+          for(G4int k = 0; k < NumHCalLayers; k++)
+          { 
+            auto HCalTileHit = HCalTiles[towerCell + k];
+            G4double edep = HCalTileHit ? HCalTileHit->GetEdep() : 0.;
+            HCalTowerEdep += edep;
+            fillTile(i, j, k, edep, HCalTileHit ? HCalTileHit->GetNumHits() : 0);
+          }
+          fillTower(i, j, HCalTowerEdep);
+        }
+      }
+    }
+
+    // Getting ECal information.
+    auto ECalHC = GetHitsCollection(fECalHCID, event);
+    auto ECalTotalHit = (*ECalHC)[0];
+    ECal_Edep = ECalTotalHit->GetEdep();
+    ECal_hits = ECalTotalHit->GetNumHits();
+    ECal_Npe = ECalTotalHit->GetPhotoelectrons();
+    fRunAction->AddECalEdep(ECal_Edep);
+
+    // Cells below block level (ecalGranularity) are written as they are
+    // and summed into their blocks
+    for(std::size_t n = 1; n < ECalHC->entries(); n++)
+    {
+      auto id = (*ECalHC)[n]->GetCellID();
+      if(CellID::Fiber(id) > 0) fillSubCell(id, (*ECalHC)[n]->GetEdep());
+    }
+
+    if(SparseOutput)
+    {
+      std::map<CellID::Type, std::pair<G4double, G4double>> ECalBlockEdep; // energy and photoelectrons
+      for(std::size_t n = 1; n < ECalHC->entries(); n++)
+      {
+        auto id = (*ECalHC)[n]->GetCellID();
+        auto& block = ECalBlockEdep[CellID::Encode(CellID::kECal, CellID::X(id), CellID::Y(id))];
+        block.first += (*ECalHC)[n]->GetEdep();
+        block.second += (*ECalHC)[n]->GetPhotoelectrons();
+      }
+      for(const auto& block : ECalBlockEdep)
+        fillBlock(CellID::X(block.first), CellID::Y(block.first), block.second.first, block.second.second);
+    }
+    else
+    {
+      // Cells are numbered i*NumECalBlocks + j
+      std::vector<G4double> ECalBlockEdep(NumECalBlocks*NumECalBlocks, 0.);
+      std::vector<G4double> ECalBlockNpe(NumECalBlocks*NumECalBlocks, 0.);
+      for(std::size_t n = 1; n < ECalHC->entries(); n++)
+      {
+        auto id = (*ECalHC)[n]->GetCellID();
+        ECalBlockEdep[CellID::X(id)*NumECalBlocks + CellID::Y(id)] += (*ECalHC)[n]->GetEdep();
+        ECalBlockNpe[CellID::X(id)*NumECalBlocks + CellID::Y(id)] += (*ECalHC)[n]->GetPhotoelectrons();
+      }
 
-  for(G4int i = 0; i < NumECalBlocks; i++)
+      for(G4int i = 0; i < NumECalBlocks; i++)
+        for(G4int j = 0; j < NumECalBlocks; j++)
+          fillBlock(i, j, ECalBlockEdep[i*NumECalBlocks + j], ECalBlockNpe[i*NumECalBlocks + j]);
+    }
+
+    // Ntuple with id 7 holds the deposits per integration window of the touched cells
+    if(NumTimeWindows > 1)
+    {
+      for(auto HC : {HCalHC, ECalHC})
+      {
+        for(std::size_t n = 1; n < HC->entries(); n++)
+        {
+          auto hit = (*HC)[n];
+          for(G4int window = 0; window < NumTimeWindows; window++)
+          {
+            if(hit->GetEdep(window) == 0.) continue;
+            analysisManager->FillNtupleDColumn(7, 0, hit->GetEdep(window));
+            analysisManager->FillNtupleIColumn(7, 1, window);
+            analysisManager->FillNtupleIColumn(7, 2, eventID);
+            analysisManager->FillNtupleDColumn(7, 3, hit->GetCellID());
+            analysisManager->AddNtupleRow(7);
+          }
+        }
+      }
+    }
+  }
+
+  // Readout cells, always sparse
+  if(fECalReadoutHCID >= 0)
+  {
+    auto ECalReadoutHC = GetHitsCollection(fECalReadoutHCID, event);
+    for(std::size_t n = 1; n < ECalReadoutHC->entries(); n++)
+    {
+      auto hit = (*ECalReadoutHC)[n];
+
+      // Ntuple with id 4 holds ECal readout cell information
+      analysisManager->FillNtupleDColumn(4, 0, hit->GetEdep());
+      analysisManager->FillNtupleIColumn(4, 1, CellID::X(hit->GetCellID()));
+      analysisManager->FillNtupleIColumn(4, 2, CellID::Y(hit->GetCellID()));
+      analysisManager->FillNtupleIColumn(4, 3, eventID);
+      analysisManager->FillNtupleDColumn(4, 4, hit->GetCellID());
+      analysisManager->AddNtupleRow(4);
+    }
+  }
+
+  if(fHCalReadoutHCID >= 0)
   {
-    for(G4int j = 0; j < NumECalBlocks; j++)
+    auto HCalReadoutHC = GetHitsCollection(fHCalReadoutHCID, event);
+    for(std::size_t n = 1; n < HCalReadoutHC->entries(); n++)
     {
-      sprintf(nameHolder, "ECalHitsCollection%d%d", i, j);
-      G4int ECalHCID = G4SDManager::GetSDMpointer()->GetCollectionID(nameHolder);
-      auto ECalHC = GetHitsCollection(ECalHCID, event);
-      auto ECalHit = (*ECalHC)[ECalHC->entries()-1]; // entries()-1 kept track of information for whole block
-      ECal_Edep += ECalHit->GetEdep();
-      ECal_hits += ECalHit->GetNumHits();
-
-      // Ntuple with id 1 holds ECal information
-      analysisManager->FillNtupleDColumn(1, 0, ECalHit->GetEdep());
-      analysisManager->FillNtupleIColumn(1, 1, i);
-      analysisManager->FillNtupleIColumn(1, 2, j);
-      analysisManager->FillNtupleIColumn(1, 3, eventID);
-      analysisManager->AddNtupleRow(1);
+      auto hit = (*HCalReadoutHC)[n];
+
+      // Ntuple with id 5 holds HCal readout section information
+      analysisManager->FillNtupleDColumn(5, 0, hit->GetEdep());
+      analysisManager->FillNtupleIColumn(5, 1, CellID::Layer(hit->GetCellID()));
+      analysisManager->FillNtupleIColumn(5, 2, CellID::X(hit->GetCellID()));
+      analysisManager->FillNtupleIColumn(5, 3, CellID::Y(hit->GetCellID()));
+      analysisManager->FillNtupleIColumn(5, 4, eventID);
+      analysisManager->FillNtupleDColumn(5, 5, hit->GetCellID());
+      analysisManager->AddNtupleRow(5);
     }
   }
-  
+
   // Ntuple with id 0 holds total information
   analysisManager->FillNtupleDColumn(0, 0, ECal_Edep);
   analysisManager->FillNtupleDColumn(0, 1, HCal_Edep);
   analysisManager->FillNtupleIColumn(0, 2, ECal_hits);
   analysisManager->FillNtupleIColumn(0, 3, HCal_hits);
   analysisManager->FillNtupleIColumn(0, 4, eventID);
+  analysisManager->FillNtupleDColumn(0, 5, ECal_Npe);
   analysisManager->AddNtupleRow(0); 
 
   
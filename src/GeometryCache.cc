@@ -0,0 +1,127 @@
+/// \file GeometryCache.cc
+/// \brief Implementation of the GeometryCache class
+
+#include "GeometryCache.hh"
+
+#include "G4VPhysicalVolume.hh"
+#ifdef G4LIB_USE_GDML
+#include "G4GDMLParser.hh"
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+GeometryCache::GeometryCache(const G4String& directory)
+ : fDirectory(directory)
+{
+  // Bump the version when the geometry code changes without a parameter change
+  fKey << std::setprecision(17) << "version=2;";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+GeometryCache::~GeometryCache()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryCache::AddParameter(const G4String& name, G4double value)
+{
+  fKey << name << "=" << value << ";";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryCache::AddParameter(const G4String& name, const G4String& value)
+{
+  fKey << name << "=" << value << ";";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool GeometryCache::IsEnabled() const
+{
+#ifdef G4LIB_USE_GDML
+  return !fDirectory.empty();
+#else
+  return false;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String GeometryCache::GetFileName() const
+{
+  // 64-bit FNV-1a
+  unsigned long long hash = 14695981039346656037ULL;
+  for(unsigned char c : fKey.str())
+  {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+
+  std::ostringstream fileName;
+  fileName << fDirectory << "/ATHENA_Geometry_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".gdml";
+  return fileName.str();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VPhysicalVolume* GeometryCache::Load() const
+{
+  if(!IsEnabled()) return nullptr;
+
+  G4String fileName = GetFileName();
+  if(!std::ifstream(fileName).good()) return nullptr;
+
+#ifdef G4LIB_USE_GDML
+  G4cout << "Reading geometry from cache " << fileName << G4endl;
+  G4GDMLParser parser;
+  parser.Read(fileName, false);
+  return parser.GetWorldVolume();
+#else
+  return nullptr;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryCache::Save(G4VPhysicalVolume* worldPV) const
+{
+  if(!IsEnabled()) return;
+
+  G4String fileName = GetFileName();
+  if(std::ifstream(fileName).good()) return; // written by a concurrent job
+
+  mkdir(fDirectory.c_str(), 0755); // may already exist
+
+#ifdef G4LIB_USE_GDML
+  // Write a private file, then rename it, which is atomic within a file system
+  std::ostringstream tmpName;
+  tmpName << fileName << ".tmp." << getpid();
+  std::remove(tmpName.str().c_str());
+
+  G4GDMLParser parser;
+  parser.Write(tmpName.str(), worldPV, false);
+
+  if(std::rename(tmpName.str().c_str(), fileName.c_str()) != 0)
+  {
+    std::remove(tmpName.str().c_str());
+    G4ExceptionDescription msg;
+    msg << "Cannot move the geometry to the cache file " << fileName;
+    G4Exception("GeometryCache::Save()",
+      "MyCode0009", JustWarning, msg);
+    return;
+  }
+  G4cout << "Geometry written to cache " << fileName << G4endl;
+#else
+  (void)worldPV;
+#endif
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
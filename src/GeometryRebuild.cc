@@ -0,0 +1,126 @@
+/// \file GeometryRebuild.cc
+/// \brief Implementation of the GeometryRebuild class
+
+#include "GeometryRebuild.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VPVParameterisation.hh"
+#include "G4VSolid.hh"
+#include "G4SmartVoxelHeader.hh"
+
+#include <set>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+GeometryRebuild::GeometryRebuild()
+ : G4VStateDependent(),
+   fStage(kNone)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+GeometryRebuild::~GeometryRebuild()
+{
+  Reset();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4LogicalVolume*> GeometryRebuild::CollectTrees(const std::vector<G4LogicalVolume*>& volumes)
+{
+  // Shared logical volumes, e.g. the HCal layer holder of the tower variants, are collected once
+  std::vector<G4LogicalVolume*> trees;
+  std::set<G4LogicalVolume*> seen;
+  for(auto lv : volumes)
+    if(lv && seen.insert(lv).second) trees.push_back(lv);
+
+  for(std::size_t n = 0; n < trees.size(); n++)
+  {
+    for(std::size_t i = 0; i < trees[n]->GetNoDaughters(); i++)
+    {
+      auto daughterLV = trees[n]->GetDaughter(i)->GetLogicalVolume();
+      if(seen.insert(daughterLV).second) trees.push_back(daughterLV);
+    }
+  }
+  return trees;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryRebuild::DeleteTrees(const std::vector<G4LogicalVolume*>& volumes)
+{
+  auto trees = CollectTrees(volumes);
+
+  std::set<G4VSolid*> solids;
+  for(auto lv : trees)
+  {
+    solids.insert(lv->GetSolid());
+    delete lv->GetVoxelHeader();
+    lv->SetVoxelHeader(nullptr);
+    for(std::size_t i = 0; i < lv->GetNoDaughters(); i++)
+    {
+      auto pv = lv->GetDaughter(i);
+      if(pv->IsParameterised()) delete pv->GetParameterisation();
+      delete pv;
+    }
+  }
+
+  // A deleted root volume leaves its region by itself
+  for(auto lv : trees) delete lv;
+  for(auto solid : solids) delete solid;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryRebuild::Reset()
+{
+  if(fStage == kDetached)
+    for(auto lv : fKept) G4LogicalVolumeStore::Register(lv);
+  fKept.clear();
+  fStage = kNone;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void GeometryRebuild::KeepVoxels(const std::vector<G4LogicalVolume*>& volumes)
+{
+  auto trees = CollectTrees(volumes);
+  fKept.insert(fKept.end(), trees.begin(), trees.end());
+  fStage = kConstructing;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool GeometryRebuild::Notify(G4ApplicationState requestedState)
+{
+  switch(fStage)
+  {
+    case kConstructing:
+      // End of the geometry initialisation, the SDs are assigned
+      if(requestedState == G4State_Idle) fStage = kConstructed;
+      break;
+    case kConstructed:
+      // Start of the run initialisation, which opens and closes the geometry
+      if(requestedState == G4State_Init)
+      {
+        for(auto lv : fKept) G4LogicalVolumeStore::DeRegister(lv);
+        fStage = kDetached;
+      }
+      break;
+    case kDetached:
+      // The geometry is closed again
+      if(requestedState != G4State_Init)
+      {
+        G4cout << "Voxels of " << fKept.size() << " unchanged logical volumes kept" << G4endl;
+        Reset();
+      }
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
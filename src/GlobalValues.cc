@@ -1,8 +1,15 @@
 #include "GlobalValues.hh"
+#include "G4SystemOfUnits.hh"
 
 namespace GlobalValues
 {
-    extern const G4int NumHCalLayers = 51;
-    extern const G4int NumHCalTowers = 6;
-    extern const G4int NumECalBlocks = 8;
+    G4int NumHCalLayers = 51;
+    G4int NumHCalTowers = 6;
+    G4int NumECalBlocks = 8;
+    G4bool ECalCalibrationRun = false;
+    G4bool SparseOutput = false;
+    G4int NumTimeWindows = 0;
+    G4double TimeWindowStart = 0.;
+    G4double TimeWindowWidth = 100.*ns;
+    G4bool KillLateTracks = true;
 }
\ No newline at end of file
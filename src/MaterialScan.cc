@@ -0,0 +1,223 @@
+/// \file MaterialScan.cc
+/// \brief Implementation of the MaterialScan class
+
+#include "MaterialScan.hh"
+#include "ECalFiberParameterisation.hh"
+#include "ECalLatticeNavigation.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4Material.hh"
+#include "G4Navigator.hh"
+#include "G4Timer.hh"
+#include "G4SystemOfUnits.hh"
+#ifdef G4MULTITHREADED
+#include "G4WorkerThread.hh"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  // Volume categories of the maps, "Other" for everything not listed
+  const std::vector<G4String> kCategories
+    = {"ECalAbsorber", "ECalFiber", "ECalGlue", "HCalAbsorber", "HCalActive", "HCalWLS", "HCalSteel", "Other"};
+
+  const std::map<G4String, std::size_t> kCategoryOfVolume
+    = {{"ECalLogical", 0}, {"ECalMixtureLogical", 0},
+       {"ECal_FiberCladdingLogical", 1}, {"ECal_FiberLogical", 1},
+       {"ECal_HorizGlueLogical", 2}, {"ECal_VertGlueLogical", 2},
+       {"HCalAbsorberLogical", 3}, {"HCalActiveLogical", 4},
+       {"HCalWLSLogical", 5}, {"HCalSteelLogical", 6}};
+
+  void CollectCategories(G4LogicalVolume* lv, std::map<const G4LogicalVolume*, std::size_t>& categories)
+  {
+    if(categories.find(lv) != categories.end()) return;
+    auto it = kCategoryOfVolume.find(lv->GetName());
+    categories[lv] = (it != kCategoryOfVolume.end()) ? it->second : kCategories.size() - 1;
+    for(std::size_t i = 0; i < lv->GetNoDaughters(); i++)
+      CollectCategories(lv->GetDaughter(i)->GetLogicalVolume(), categories);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void MaterialScan::Run(G4VPhysicalVolume* worldPV, G4int nBins, G4double halfWidth,
+                       G4int nAngles, G4double maxAngle, G4int nThreads, const G4String& fileName)
+{
+  G4Timer timer;
+  timer.Start();
+
+  // Categories are looked up by logical volume, read-only on the threads
+  auto worldLV = worldPV->GetLogicalVolume();
+  std::map<const G4LogicalVolume*, std::size_t> categories;
+  CollectCategories(worldLV, categories);
+  const std::size_t nCategories = kCategories.size();
+
+  // Rays start at the -z edge of the world and cross the front face of the detector at (x, y)
+  G4ThreeVector worldMin, worldMax;
+  worldLV->GetSolid()->BoundingLimits(worldMin, worldMax);
+  G4double zStart = worldMin.z();
+  G4double zFront = worldMax.z();
+  for(std::size_t i = 0; i < worldLV->GetNoDaughters(); i++)
+  {
+    auto pv = worldLV->GetDaughter(i);
+    G4ThreeVector lo, hi;
+    pv->GetLogicalVolume()->GetSolid()->BoundingLimits(lo, hi);
+    zFront = std::min(zFront, pv->GetTranslation().z() + lo.z());
+  }
+
+  // Lattice navigation of the ECal fibers needs its own navigation per thread
+  G4LogicalVolume* blockLV = nullptr;
+  for(const auto& entry : categories)
+    if(entry.first->GetName() == "ECalLogical") blockLV = const_cast<G4LogicalVolume*>(entry.first);
+  auto fiberPV = (blockLV && blockLV->GetNoDaughters() == 1) ? blockLV->GetDaughter(0) : nullptr;
+  auto param = fiberPV ? dynamic_cast<ECalFiberParameterisation*>(fiberPV->GetParameterisation()) : nullptr;
+  G4bool lattice = param && blockLV->CharacteriseDaughters() == kExternal;
+
+  std::vector<G4double> angles;
+  for(G4int a = 0; a < nAngles; a++)
+    angles.push_back(nAngles > 1 ? maxAngle*a/(nAngles - 1) : 0.);
+  G4double binWidth = 2.*halfWidth/nBins;
+
+  // X0 and lambda per category of every ray, written by the thread of its row
+  std::vector<G4double> x0(std::size_t(nAngles)*nBins*nBins*nCategories, 0.);
+  std::vector<G4double> lambda(x0.size(), 0.);
+  std::size_t nTasks = std::size_t(nAngles)*nBins;
+
+#ifdef G4MULTITHREADED
+  if(nThreads <= 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+#else
+  nThreads = 1; // the geometry data is not thread-local
+#endif
+  nThreads = G4int(std::min(std::size_t(nThreads), nTasks));
+
+  std::atomic<std::size_t> nextTask(0);
+  std::atomic<G4long> nSteps(0);
+
+  auto worker = [&](G4int threadID)
+  {
+#ifdef G4MULTITHREADED
+    // Thread 0 is the calling thread, which owns the geometry data already
+    if(threadID > 0) G4WorkerThread::BuildGeometryAndPhysicsVector();
+#endif
+    {
+      G4Navigator navigator;
+      navigator.SetWorldVolume(worldPV);
+      if(lattice) navigator.SetExternalNavigation(new ECalLatticeNavigation(fiberPV, param));
+      G4long steps = 0;
+
+      // One task is a row of rays along y at one angle and one x
+      for(std::size_t task = nextTask++; task < nTasks; task = nextTask++)
+      {
+        G4int a = G4int(task/nBins);
+        G4int ix = G4int(task%nBins);
+        G4ThreeVector direction(0., std::sin(angles[a]), std::cos(angles[a]));
+        G4double x = -halfWidth + (ix + 0.5)*binWidth;
+
+        for(G4int iy = 0; iy < nBins; iy++)
+        {
+          G4double y = -halfWidth + (iy + 0.5)*binWidth;
+          G4ThreeVector point(x, y - (zFront - zStart)*std::tan(angles[a]), zStart);
+          std::size_t ray = ((std::size_t(a)*nBins + ix)*nBins + iy)*nCategories;
+
+          auto volume = navigator.LocateGlobalPointAndSetup(point, &direction, false, false);
+          while(volume)
+          {
+            G4double safety = 0.;
+            G4double length = navigator.ComputeStep(point, direction, kInfinity, safety);
+            if(length == kInfinity) break;
+
+            auto lv = volume->GetLogicalVolume();
+            auto material = lv->GetMaterial();
+            std::size_t c = categories.find(lv)->second;
+            x0[ray + c] += length/material->GetRadlen();
+            lambda[ray + c] += length/material->GetNuclearInterLength();
+            point += length*direction;
+            steps++;
+
+            navigator.SetGeometricallyLimitedStep();
+            volume = navigator.LocateGlobalPointAndSetup(point, &direction, true);
+          }
+        }
+      }
+      nSteps += steps;
+    }
+#ifdef G4MULTITHREADED
+    if(threadID > 0) G4WorkerThread::DestroyGeometryAndPhysicsVector();
+#endif
+  };
+
+  std::vector<std::thread> threads;
+  for(G4int i = 1; i < nThreads; i++) threads.push_back(std::thread(worker, i));
+  worker(0);
+  for(auto& thread : threads) thread.join();
+  timer.Stop();
+
+  G4long nRays = G4long(nTasks)*nBins;
+  G4cout << G4endl << "Material scan: " << nRays << " rays, " << nSteps << " steps, "
+         << nThreads << " threads, " << timer.GetRealElapsed() << " s" << G4endl;
+
+  // Average over the rays of each angle
+  for(G4int a = 0; a < nAngles; a++)
+  {
+    std::vector<G4double> meanX0(nCategories, 0.), meanLambda(nCategories, 0.);
+    for(std::size_t ray = std::size_t(a)*nBins*nBins; ray < std::size_t(a + 1)*nBins*nBins; ray++)
+    {
+      for(std::size_t c = 0; c < nCategories; c++)
+      {
+        meanX0[c] += x0[ray*nCategories + c]/(nBins*nBins);
+        meanLambda[c] += lambda[ray*nCategories + c]/(nBins*nBins);
+      }
+    }
+    G4double totalX0 = 0., totalLambda = 0.;
+    for(std::size_t c = 0; c < nCategories; c++) { totalX0 += meanX0[c]; totalLambda += meanLambda[c]; }
+
+    G4cout << "  angle " << angles[a]/deg << " deg: mean " << totalX0 << " X0, " << totalLambda << " lambda" << G4endl;
+    for(std::size_t c = 0; c < nCategories; c++)
+      G4cout << "    " << kCategories[c] << ": " << meanX0[c] << " X0, " << meanLambda[c] << " lambda" << G4endl;
+  }
+
+  std::ofstream output(fileName);
+  if(!output)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the material scan " << fileName;
+    G4Exception("MaterialScan::Run()",
+      "MyCode0020", JustWarning, msg);
+    return;
+  }
+
+  // Branch descriptor of TTree::ReadFile, then one ray per line (mm, deg)
+  output << "x/D:y/D:angle/D:X0/D:lambda/D";
+  for(const auto& category : kCategories) output << ":" << category << "_X0/D:" << category << "_lambda/D";
+  output << "\n";
+  for(G4int a = 0; a < nAngles; a++)
+  {
+    for(G4int ix = 0; ix < nBins; ix++)
+    {
+      for(G4int iy = 0; iy < nBins; iy++)
+      {
+        std::size_t ray = ((std::size_t(a)*nBins + ix)*nBins + iy)*nCategories;
+        G4double totalX0 = 0., totalLambda = 0.;
+        for(std::size_t c = 0; c < nCategories; c++) { totalX0 += x0[ray + c]; totalLambda += lambda[ray + c]; }
+
+        output << (-halfWidth + (ix + 0.5)*binWidth)/mm << " " << (-halfWidth + (iy + 0.5)*binWidth)/mm
+               << " " << angles[a]/deg << " " << totalX0 << " " << totalLambda;
+        for(std::size_t c = 0; c < nCategories; c++) output << " " << x0[ray + c] << " " << lambda[ray + c];
+        output << "\n";
+      }
+    }
+  }
+  G4cout << "Material scan written to " << fileName << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
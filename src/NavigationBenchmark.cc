@@ -0,0 +1,116 @@
+/// \file NavigationBenchmark.cc
+/// \brief Implementation of the NavigationBenchmark class
+
+#include "NavigationBenchmark.hh"
+#include "ECalFiberParameterisation.hh"
+#include "ECalLatticeNavigation.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4TransportationManager.hh"
+#include "G4Navigator.hh"
+#include "G4Box.hh"
+#include "G4Timer.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void NavigationBenchmark::RunECalLattice(G4int nTracks, G4int maxSteps)
+{
+  auto blockLV = G4LogicalVolumeStore::GetInstance()->GetVolume("ECalLogical", false);
+  auto fiberPV = (blockLV && blockLV->GetNoDaughters() == 1) ? blockLV->GetDaughter(0) : nullptr;
+  auto param = fiberPV ? dynamic_cast<ECalFiberParameterisation*>(fiberPV->GetParameterisation()) : nullptr;
+  if ( ! param ) {
+    G4ExceptionDescription msg;
+    msg << "The lattice benchmark needs parameterised ECal fibers "
+        << "(/athena/geometry/fiberPlacement parameterised).";
+    G4Exception("NavigationBenchmark::RunECalLattice()",
+      "MyCode0007", JustWarning, msg);
+    return;
+  }
+  auto claddingLV = fiberPV->GetLogicalVolume();
+  auto coreLV = claddingLV->GetDaughter(0)->GetLogicalVolume();
+
+  auto worldPV = G4TransportationManager::GetTransportationManager()
+                   ->GetNavigatorForTracking()->GetWorldVolume();
+  std::vector<G4VPhysicalVolume*> blocks;
+  for(std::size_t i = 0; i < worldPV->GetLogicalVolume()->GetNoDaughters(); i++)
+  {
+    auto daughter = worldPV->GetLogicalVolume()->GetDaughter(i);
+    if(daughter->GetLogicalVolume() == blockLV) blocks.push_back(daughter);
+  }
+  auto blockBox = static_cast<G4Box*>(blockLV->GetSolid());
+
+  // Same starting points and directions for both modes
+  std::vector<G4ThreeVector> points, directions;
+  for(G4int i = 0; i < nTracks; i++)
+  {
+    auto block = blocks[G4int(G4UniformRand()*blocks.size())];
+    G4ThreeVector local((2.*G4UniformRand() - 1.)*blockBox->GetXHalfLength(),
+                        (2.*G4UniformRand() - 1.)*blockBox->GetYHalfLength(),
+                        (2.*G4UniformRand() - 1.)*blockBox->GetZHalfLength());
+    points.push_back(block->GetTranslation() + local);
+
+    G4double cosTheta = 2.*G4UniformRand() - 1.;
+    G4double sinTheta = std::sqrt(1. - cosTheta*cosTheta);
+    G4double phi = twopi*G4UniformRand();
+    directions.push_back(G4ThreeVector(sinTheta*std::cos(phi), sinTheta*std::sin(phi), cosTheta));
+  }
+
+  EVolume savedType = blockLV->CharacteriseDaughters();
+  const char* modeNames[2] = {"voxel", "lattice"};
+  G4double timePerStep[2] = {0., 0.};
+  G4long nSteps[2] = {0, 0};
+  G4double pathLength[2] = {0., 0.};
+
+  for(G4int mode = 0; mode < 2; mode++)
+  {
+    blockLV->ChangeDaughtersType(mode == 1 ? kExternal : kParameterised);
+    G4Navigator navigator;
+    navigator.SetWorldVolume(worldPV);
+    if(mode == 1) navigator.SetExternalNavigation(new ECalLatticeNavigation(fiberPV, param));
+
+    G4Timer timer;
+    timer.Start();
+    for(G4int i = 0; i < nTracks; i++)
+    {
+      G4ThreeVector point = points[i];
+      const G4ThreeVector& direction = directions[i];
+      navigator.LocateGlobalPointAndSetup(point, &direction, false, false);
+
+      for(G4int step = 0; step < maxSteps; step++)
+      {
+        G4double safety = 0.;
+        G4double length = navigator.ComputeStep(point, direction, kInfinity, safety);
+        point += length*direction;
+        pathLength[mode] += length;
+        nSteps[mode]++;
+
+        navigator.SetGeometricallyLimitedStep();
+        auto volume = navigator.LocateGlobalPointAndSetup(point, &direction, true);
+        if ( ! volume ) break;
+        auto lv = volume->GetLogicalVolume();
+        if ( lv != blockLV && lv != claddingLV && lv != coreLV ) break;
+      }
+    }
+    timer.Stop();
+    timePerStep[mode] = nSteps[mode] ? timer.GetRealElapsed()/nSteps[mode] : 0.;
+  }
+  blockLV->ChangeDaughtersType(savedType);
+
+  G4cout << G4endl << "ECal fiber navigation benchmark, " << nTracks << " tracks:" << G4endl;
+  for(G4int mode = 0; mode < 2; mode++)
+  {
+    G4cout << "  " << modeNames[mode] << ": " << nSteps[mode] << " steps, path length "
+           << pathLength[mode]/mm << " mm, " << timePerStep[mode]*1.e9 << " ns/step" << G4endl;
+  }
+  if(timePerStep[1] > 0.) G4cout << "  speed-up: " << timePerStep[0]/timePerStep[1] << G4endl;
+  if(nSteps[0] != nSteps[1]) G4cout << "  WARNING: the two modes took different numbers of steps" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,413 @@
+/// \file OverlapChecker.cc
+/// \brief Implementation of the OverlapChecker class
+
+#include "OverlapChecker.hh"
+
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VPVParameterisation.hh"
+#include "G4VSolid.hh"
+#include "G4AffineTransform.hh"
+#include "G4Timer.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  // One daughter placement, or one copy of a parameterised daughter, in the frame of its mother
+  struct Placement
+  {
+    const G4VSolid* solid;
+    G4AffineTransform toMother;
+    G4AffineTransform fromMother;
+    G4ThreeVector pmin, pmax; // bounding box in the mother frame
+    G4String name; // logical volume
+    G4int copyNo;
+    G4double volume;
+    G4long nPoints;
+  };
+
+  // A logical volume with daughters, checked once for all its placements
+  struct Template
+  {
+    G4String name;
+    const G4VSolid* solid;
+    G4long placements;
+    std::vector<Placement> daughters;
+
+    // Uniform grid of daughter bounding boxes, to find the sisters near a point
+    G4ThreeVector gridMin, cellSize;
+    G4int nCells[3];
+    std::vector< std::vector<std::size_t> > cells;
+
+    G4int CellCoordinate(G4double x, G4int axis) const
+    {
+      G4int i = G4int((x - gridMin[axis])/cellSize[axis]);
+      return std::min(std::max(i, 0), nCells[axis] - 1);
+    }
+
+    std::size_t CellIndex(G4int ix, G4int iy, G4int iz) const
+    {
+      return (std::size_t(ix)*nCells[1] + iy)*nCells[2] + iz;
+    }
+  };
+
+  struct Issue
+  {
+    G4long count = 0;
+    G4double maxDepth = 0.;
+    G4int daughterCopy = 0;
+    G4int otherCopy = -1;
+    G4ThreeVector point; // in the mother frame
+  };
+
+  // template, daughter logical volume, other logical volume ("" for the mother)
+  typedef std::tuple<std::size_t, G4String, G4String> IssueKey;
+
+  struct ThreadResult
+  {
+    std::map<IssueKey, Issue> issues;
+    std::vector<G4long> points;
+  };
+
+  //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+  void CountPlacements(G4LogicalVolume* lv, G4long multiplicity,
+                       std::map<G4LogicalVolume*, G4long>& placements,
+                       std::vector<G4LogicalVolume*>& order)
+  {
+    if(placements.find(lv) == placements.end()) order.push_back(lv);
+    placements[lv] += multiplicity;
+    for(std::size_t i = 0; i < lv->GetNoDaughters(); i++)
+    {
+      auto daughter = lv->GetDaughter(i);
+      CountPlacements(daughter->GetLogicalVolume(), multiplicity*daughter->GetMultiplicity(), placements, order);
+    }
+  }
+
+  //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+  Placement MakePlacement(const G4VSolid* solid, const G4VPhysicalVolume* pv, G4int copyNo)
+  {
+    Placement placement;
+    placement.solid = solid;
+    placement.toMother = G4AffineTransform(pv->GetRotation(), pv->GetTranslation());
+    placement.fromMother = placement.toMother.Inverse();
+    placement.name = pv->GetLogicalVolume()->GetName();
+    placement.copyNo = copyNo;
+    placement.volume = 0.;
+    placement.nPoints = 0;
+
+    G4ThreeVector lo, hi;
+    solid->BoundingLimits(lo, hi);
+    placement.pmin = G4ThreeVector(kInfinity, kInfinity, kInfinity);
+    placement.pmax = -placement.pmin;
+    for(G4int corner = 0; corner < 8; corner++)
+    {
+      G4ThreeVector p((corner & 1) ? hi.x() : lo.x(), (corner & 2) ? hi.y() : lo.y(), (corner & 4) ? hi.z() : lo.z());
+      p = placement.toMother.TransformPoint(p);
+      for(G4int axis = 0; axis < 3; axis++)
+      {
+        placement.pmin[axis] = std::min(placement.pmin[axis], p[axis]);
+        placement.pmax[axis] = std::max(placement.pmax[axis], p[axis]);
+      }
+    }
+    return placement;
+  }
+
+  //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+  void BuildGrid(Template& tmpl)
+  {
+    G4ThreeVector lo, hi, size;
+    tmpl.solid->BoundingLimits(lo, hi);
+    for(const auto& daughter : tmpl.daughters) size += (daughter.pmax - daughter.pmin);
+    size /= tmpl.daughters.size();
+
+    tmpl.gridMin = lo;
+    for(G4int axis = 0; axis < 3; axis++)
+    {
+      G4double extent = hi[axis] - lo[axis];
+      tmpl.nCells[axis] = (size[axis] > 0.) ? std::min(std::max(G4int(extent/size[axis]), 1), 128) : 1;
+      tmpl.cellSize[axis] = extent/tmpl.nCells[axis];
+    }
+    tmpl.cells.assign(std::size_t(tmpl.nCells[0])*tmpl.nCells[1]*tmpl.nCells[2], std::vector<std::size_t>());
+
+    for(std::size_t d = 0; d < tmpl.daughters.size(); d++)
+    {
+      const auto& daughter = tmpl.daughters[d];
+      G4int first[3], last[3];
+      for(G4int axis = 0; axis < 3; axis++)
+      {
+        first[axis] = tmpl.CellCoordinate(daughter.pmin[axis], axis);
+        last[axis] = tmpl.CellCoordinate(daughter.pmax[axis], axis);
+      }
+      for(G4int ix = first[0]; ix <= last[0]; ix++)
+        for(G4int iy = first[1]; iy <= last[1]; iy++)
+          for(G4int iz = first[2]; iz <= last[2]; iz++)
+            tmpl.cells[tmpl.CellIndex(ix, iy, iz)].push_back(d);
+    }
+  }
+
+  //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+  void Record(ThreadResult& result, std::size_t t, const Placement& daughter,
+              const G4String& other, G4int otherCopy, G4double depth, const G4ThreeVector& point)
+  {
+    auto& issue = result.issues[IssueKey(t, daughter.name, other)];
+    issue.count++;
+    if(depth > issue.maxDepth)
+    {
+      issue.maxDepth = depth;
+      issue.daughterCopy = daughter.copyNo;
+      issue.otherCopy = otherCopy;
+      issue.point = point;
+    }
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OverlapChecker::Run(G4VPhysicalVolume* worldPV, G4long nPoints, G4int nThreads,
+                         G4double tolerance, const G4String& reportFile, G4int minPoints)
+{
+  G4Timer timer;
+  timer.Start();
+
+  // Flatten the daughters of every template on this thread
+  std::map<G4LogicalVolume*, G4long> placements;
+  std::vector<G4LogicalVolume*> order;
+  CountPlacements(worldPV->GetLogicalVolume(), 1, placements, order);
+
+  std::vector<Template> templates;
+  std::map<const G4VSolid*, G4double> volumes;
+  G4double totalVolume = 0.;
+  for(auto lv : order)
+  {
+    if(lv->GetNoDaughters() == 0) continue;
+    Template tmpl;
+    tmpl.name = lv->GetName();
+    tmpl.solid = lv->GetSolid();
+    tmpl.placements = placements[lv];
+
+    for(std::size_t i = 0; i < lv->GetNoDaughters(); i++)
+    {
+      auto pv = lv->GetDaughter(i);
+      if(pv->IsParameterised())
+      {
+        auto param = pv->GetParameterisation();
+        for(G4int copyNo = 0; copyNo < pv->GetMultiplicity(); copyNo++)
+        {
+          auto solid = param->ComputeSolid(copyNo, pv);
+          param->ComputeTransformation(copyNo, pv);
+          tmpl.daughters.push_back(MakePlacement(solid, pv, copyNo));
+        }
+      }
+      else if(!pv->IsReplicated())
+        tmpl.daughters.push_back(MakePlacement(pv->GetLogicalVolume()->GetSolid(), pv, pv->GetCopyNo()));
+      // Replicas fill the mother by construction
+    }
+    if(tmpl.daughters.empty()) continue;
+
+    for(auto& daughter : tmpl.daughters)
+    {
+      auto it = volumes.find(daughter.solid);
+      if(it == volumes.end())
+        it = volumes.insert(std::make_pair(daughter.solid, const_cast<G4VSolid*>(daughter.solid)->GetCubicVolume())).first;
+      daughter.volume = it->second;
+      totalVolume += daughter.volume;
+    }
+    BuildGrid(tmpl);
+    templates.push_back(tmpl);
+  }
+
+  // Points in proportion to the volume of each daughter
+  std::vector< std::pair<std::size_t, std::size_t> > tasks;
+  for(std::size_t t = 0; t < templates.size(); t++)
+  {
+    for(std::size_t d = 0; d < templates[t].daughters.size(); d++)
+    {
+      auto& daughter = templates[t].daughters[d];
+      daughter.nPoints = std::max(G4long(minPoints), G4long(nPoints*daughter.volume/totalVolume + 0.5));
+      tasks.push_back(std::make_pair(t, d));
+    }
+  }
+
+#ifdef G4MULTITHREADED
+  if(nThreads <= 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+#else
+  nThreads = 1; // the random engine is shared
+#endif
+
+  std::vector<ThreadResult> results(nThreads);
+  std::atomic<std::size_t> nextTask(0);
+  std::vector<long> seeds;
+  for(G4int i = 0; i < nThreads; i++) seeds.push_back(long(G4UniformRand()*2147483647.));
+
+  auto worker = [&](G4int threadID)
+  {
+#ifdef G4MULTITHREADED
+    // The random engine is thread-local, give each thread its own sequence.
+    // Thread 0 is the calling thread, whose engine is restored at the end.
+    auto previousEngine = G4Random::getTheEngine();
+    std::unique_ptr<CLHEP::HepRandomEngine> engine(new CLHEP::MixMaxRng(seeds[threadID]));
+    G4Random::setTheEngine(engine.get());
+#endif
+    ThreadResult& result = results[threadID];
+    result.points.assign(templates.size(), 0);
+
+    for(std::size_t task = nextTask++; task < tasks.size(); task = nextTask++)
+    {
+      std::size_t t = tasks[task].first;
+      std::size_t d = tasks[task].second;
+      const auto& tmpl = templates[t];
+      const auto& daughter = tmpl.daughters[d];
+
+      for(G4long n = 0; n < daughter.nPoints; n++)
+      {
+        G4ThreeVector mp = daughter.toMother.TransformPoint(daughter.solid->GetPointOnSurface());
+
+        // Protruding from the mother
+        if(tmpl.solid->Inside(mp) == kOutside)
+        {
+          G4double depth = tmpl.solid->DistanceToIn(mp);
+          if(depth > tolerance) Record(result, t, daughter, "", -1, depth, mp);
+        }
+
+        // Inside a sister
+        const auto& cell = tmpl.cells[tmpl.CellIndex(tmpl.CellCoordinate(mp.x(), 0),
+                                                     tmpl.CellCoordinate(mp.y(), 1),
+                                                     tmpl.CellCoordinate(mp.z(), 2))];
+        for(auto s : cell)
+        {
+          if(s == d) continue;
+          const auto& sister = tmpl.daughters[s];
+          if(mp.x() < sister.pmin.x() || mp.x() > sister.pmax.x() ||
+             mp.y() < sister.pmin.y() || mp.y() > sister.pmax.y() ||
+             mp.z() < sister.pmin.z() || mp.z() > sister.pmax.z()) continue;
+
+          G4ThreeVector sp = sister.fromMother.TransformPoint(mp);
+          if(sister.solid->Inside(sp) != kInside) continue;
+          G4double depth = sister.solid->DistanceToOut(sp);
+          if(depth > tolerance) Record(result, t, daughter, sister.name, sister.copyNo, depth, mp);
+        }
+      }
+      result.points[t] += daughter.nPoints;
+    }
+#ifdef G4MULTITHREADED
+    G4Random::setTheEngine(previousEngine);
+#endif
+  };
+
+  std::vector<std::thread> threads;
+  for(G4int i = 1; i < nThreads; i++) threads.push_back(std::thread(worker, i));
+  worker(0);
+  for(auto& thread : threads) thread.join();
+
+  // Merge
+  std::map<IssueKey, Issue> issues;
+  std::vector<G4long> points(templates.size(), 0);
+  for(const auto& result : results)
+  {
+    for(std::size_t t = 0; t < templates.size(); t++) points[t] += result.points[t];
+    for(const auto& entry : result.issues)
+    {
+      auto& issue = issues[entry.first];
+      issue.count += entry.second.count;
+      if(entry.second.maxDepth > issue.maxDepth)
+      {
+        issue.maxDepth = entry.second.maxDepth;
+        issue.daughterCopy = entry.second.daughterCopy;
+        issue.otherCopy = entry.second.otherCopy;
+        issue.point = entry.second.point;
+      }
+    }
+  }
+  timer.Stop();
+
+  G4long totalPoints = 0, totalOverlaps = 0;
+  for(auto n : points) totalPoints += n;
+  for(const auto& entry : issues) totalOverlaps += entry.second.count;
+
+  // Summary
+  G4cout << G4endl << "Overlap check: " << templates.size() << " logical volumes, "
+         << totalPoints << " points, " << nThreads << " threads, "
+         << timer.GetRealElapsed() << " s" << G4endl;
+  for(std::size_t t = 0; t < templates.size(); t++)
+  {
+    G4cout << "  " << templates[t].name << " (" << templates[t].placements << " placements, "
+           << templates[t].daughters.size() << " daughters, " << points[t] << " points)" << G4endl;
+    for(const auto& entry : issues)
+    {
+      if(std::get<0>(entry.first) != t) continue;
+      const auto& other = std::get<2>(entry.first);
+      G4cout << "    OVERLAP " << std::get<1>(entry.first) << " " << entry.second.daughterCopy
+             << (other.empty() ? G4String(" protrudes from the mother") : G4String(" overlaps " + other + " " + std::to_string(entry.second.otherCopy)))
+             << ": " << entry.second.count << " points, up to " << entry.second.maxDepth/mm << " mm" << G4endl;
+    }
+  }
+  G4cout << "Overlap check found " << totalOverlaps << " overlapping points." << G4endl;
+
+  // Report
+  std::ofstream report(reportFile);
+  if(!report)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the overlap report " << reportFile;
+    G4Exception("OverlapChecker::Run()",
+      "MyCode0012", JustWarning, msg);
+    return;
+  }
+  report << "{\n"
+         << "  \"threads\": " << nThreads << ",\n"
+         << "  \"points\": " << totalPoints << ",\n"
+         << "  \"tolerance_mm\": " << tolerance/mm << ",\n"
+         << "  \"seconds\": " << timer.GetRealElapsed() << ",\n"
+         << "  \"overlaps\": " << totalOverlaps << ",\n"
+         << "  \"templates\": [";
+  for(std::size_t t = 0; t < templates.size(); t++)
+  {
+    G4long overlaps = 0;
+    for(const auto& entry : issues) if(std::get<0>(entry.first) == t) overlaps += entry.second.count;
+
+    report << (t ? "," : "") << "\n    {\"logical_volume\": \"" << templates[t].name << "\""
+           << ", \"placements\": " << templates[t].placements
+           << ", \"daughters\": " << templates[t].daughters.size()
+           << ", \"points\": " << points[t]
+           << ", \"overlaps\": " << overlaps
+           << ", \"issues\": [";
+    G4bool first = true;
+    for(const auto& entry : issues)
+    {
+      if(std::get<0>(entry.first) != t) continue;
+      const auto& issue = entry.second;
+      const auto& other = std::get<2>(entry.first);
+      report << (first ? "" : ",") << "\n      {\"daughter\": \"" << std::get<1>(entry.first) << "\""
+             << ", \"daughter_copy\": " << issue.daughterCopy
+             << ", \"kind\": \"" << (other.empty() ? "mother" : "sister") << "\""
+             << ", \"other\": \"" << other << "\""
+             << ", \"other_copy\": " << issue.otherCopy
+             << ", \"count\": " << issue.count
+             << ", \"max_depth_mm\": " << issue.maxDepth/mm
+             << ", \"point_mm\": [" << issue.point.x()/mm << ", " << issue.point.y()/mm << ", " << issue.point.z()/mm << "]}";
+      first = false;
+    }
+    report << (first ? "]}" : "\n    ]}");
+  }
+  report << "\n  ]\n}\n";
+  G4cout << "Overlap report written to " << reportFile << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,295 @@
+/// \file ReadoutWorld.cc
+/// \brief Implementation of the ReadoutWorld class
+
+#include "ReadoutWorld.hh"
+#include "CalorimeterSD.hh"
+#include "UnifiedCalorimeterSD.hh"
+#include "CellID.hh"
+#include "GlobalValues.hh"
+#include "GeometryRebuild.hh"
+
+#include "G4Box.hh"
+#include "G4LogicalVolume.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4PVPlacement.hh"
+#include "G4PVReplica.hh"
+#include "G4SDManager.hh"
+#include "G4GenericMessenger.hh"
+#include "G4RunManager.hh"
+#include "G4StateManager.hh"
+#include "G4VisAttributes.hh"
+#include "G4VUserDetectorConstruction.hh"
+#include "G4VModularPhysicsList.hh"
+#include "G4ParallelWorldPhysics.hh"
+
+#include <algorithm>
+#include <vector>
+
+using namespace GlobalValues;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ReadoutWorld::ReadoutWorld(const G4String& worldName)
+ : G4VUserParallelWorld(worldName),
+   fMessenger(nullptr),
+   fECalSegments(0),
+   fHCalSections(0),
+   fDetector(nullptr),
+   fPhysicsList(nullptr),
+   fRegistered(false)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+ReadoutWorld::~ReadoutWorld()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ReadoutWorld::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/athena/readout/", "Readout segmentation control");
+
+  auto& ecalSegmentsCmd
+    = fMessenger->DeclareMethod("ecalSegments", &ReadoutWorld::SetECalSegments,
+        "Number of readout cells along x and y in each ECal block, 0 for none.\n"
+        "The readout world is only built if this or hcalSections is set before /run/initialize.");
+  ecalSegmentsCmd.SetParameterName("n", false);
+  ecalSegmentsCmd.SetRange("n>=0 && n<64");
+  ecalSegmentsCmd.SetStates(G4State_PreInit, G4State_Idle);
+
+  auto& hcalSectionsCmd
+    = fMessenger->DeclareMethod("hcalSections", &ReadoutWorld::SetHCalSections,
+        "Number of readout depth sections in each HCal tower, 0 for none.\n"
+        "The readout world is only built if this or ecalSegments is set before /run/initialize.");
+  hcalSectionsCmd.SetParameterName("n", false);
+  hcalSectionsCmd.SetRange("n>=0 && n<1024");
+  hcalSectionsCmd.SetStates(G4State_PreInit, G4State_Idle);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ReadoutWorld::SetRegistration(G4VUserDetectorConstruction* detector, G4VModularPhysicsList* physicsList)
+{
+  fDetector = detector;
+  fPhysicsList = physicsList;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ReadoutWorld::Register()
+{
+  if(fRegistered || (fECalSegments == 0 && fHCalSections == 0)) return;
+
+  // Parallel worlds and their physics can only be added before /run/initialize
+  if(G4StateManager::GetStateManager()->GetCurrentState() != G4State_PreInit || !fDetector || !fPhysicsList)
+  {
+    G4ExceptionDescription msg;
+    msg << "The readout world must be enabled with /athena/readout/ecalSegments or hcalSections"
+        << " before /run/initialize, no readout cells are scored.";
+    G4Exception("ReadoutWorld::Register()",
+      "MyCode0025", JustWarning, msg);
+    return;
+  }
+  fDetector->RegisterParallelWorld(this);
+  fPhysicsList->RegisterPhysics(new G4ParallelWorldPhysics(GetName()));
+  fRegistered = true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ReadoutWorld::SegmentationHasChanged()
+{
+  Register();
+
+  // The parallel world is rebuilt at the next BeamOn, the mass volumes are kept
+  if(fRegistered && G4StateManager::GetStateManager()->GetCurrentState() == G4State_Idle)
+    G4RunManager::GetRunManager()->ReinitializeGeometry(false);
+}
+
+void ReadoutWorld::SetECalSegments(G4int n)
+{
+  fECalSegments = n;
+  SegmentationHasChanged();
+}
+
+void ReadoutWorld::SetHCalSections(G4int n)
+{
+  fHCalSections = n;
+  SegmentationHasChanged();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ReadoutWorld::Construct()
+{
+  auto ghostWorldLV = GetWorld()->GetLogicalVolume();
+  auto massWorldLV = G4LogicalVolumeStore::GetInstance()->GetVolume("WorldLogical");
+
+  // The ghost world survives a re-initialisation that keeps the volumes,
+  // its previous envelopes are replaced
+  std::vector<G4LogicalVolume*> previousLVs;
+  while(ghostWorldLV->GetNoDaughters() > 0)
+  {
+    auto pv = ghostWorldLV->GetDaughter(ghostWorldLV->GetNoDaughters() - 1);
+    if(std::find(previousLVs.begin(), previousLVs.end(), pv->GetLogicalVolume()) == previousLVs.end())
+      previousLVs.push_back(pv->GetLogicalVolume());
+    ghostWorldLV->RemoveDaughter(pv);
+    delete pv;
+  }
+  GeometryRebuild::DeleteTrees(previousLVs);
+
+  // Envelopes copy the blocks and towers of the mass world
+  G4VPhysicalVolume* ECalPV = nullptr;
+  G4VPhysicalVolume* HCalPV = nullptr;
+  for(std::size_t i = 0; i < massWorldLV->GetNoDaughters(); i++)
+  {
+    auto pv = massWorldLV->GetDaughter(i);
+    if(!ECalPV && pv->GetName() == "ECalPhysical") ECalPV = pv;
+    if(!HCalPV && pv->GetName() == "HCalPhysical") HCalPV = pv;
+  }
+
+  // The x index of the ECal cells is stored in CellID::kXBits bits
+  if(NumECalBlocks*fECalSegments > CellID::kMaxXY)
+  {
+    G4ExceptionDescription msg;
+    msg << NumECalBlocks << " ECal blocks of " << fECalSegments << " readout segments give "
+        << NumECalBlocks*fECalSegments << " cells per side, the CellID holds at most " << CellID::kMaxXY;
+    G4Exception("ReadoutWorld::Construct()",
+      "MyCode0017", FatalException, msg);
+  }
+
+  if(fHCalSections > 0 && NumHCalLayers % fHCalSections != 0)
+  {
+    G4ExceptionDescription msg;
+    msg << fHCalSections << " HCal readout sections split the " << NumHCalLayers
+        << " layers unevenly, layers are scored in the section of their step.";
+    G4Exception("ReadoutWorld::Construct()",
+      "MyCode0017", JustWarning, msg);
+  }
+
+  G4VisAttributes invis = G4VisAttributes::Invisible;
+
+  // ECal touchable: cell (0) / column (1) / block envelope (2)
+  if(ECalPV && fECalSegments > 0)
+  {
+    auto blockS = static_cast<const G4Box*>(ECalPV->GetLogicalVolume()->GetSolid());
+    G4double dx = blockS->GetXHalfLength();
+    G4double dy = blockS->GetYHalfLength();
+    G4double dz = blockS->GetZHalfLength();
+    G4int n = fECalSegments;
+
+    auto blockLV = new G4LogicalVolume(new G4Box("ECalReadoutSolid", dx, dy, dz), nullptr, "ECalReadoutLogical");
+    auto columnLV = new G4LogicalVolume(new G4Box("ECalReadoutColumnSolid", dx/n, dy, dz), nullptr, "ECalReadoutColumnLogical");
+    auto cellLV = new G4LogicalVolume(new G4Box("ECalReadoutCellSolid", dx/n, dy/n, dz), nullptr, "ECalReadoutCellLogical");
+    new G4PVReplica("ECalReadoutColumnPhysical", columnLV, blockLV, kXAxis, n, 2.*dx/n);
+    new G4PVReplica("ECalReadoutCellPhysical", cellLV, columnLV, kYAxis, n, 2.*dy/n);
+    blockLV->SetVisAttributes(invis);
+    columnLV->SetVisAttributes(invis);
+    cellLV->SetVisAttributes(invis);
+
+    // Fiber and mixture blocks of a mixed ECal share the same solid
+    for(std::size_t i = 0; i < massWorldLV->GetNoDaughters(); i++)
+    {
+      auto pv = massWorldLV->GetDaughter(i);
+      if(pv->GetName() != "ECalPhysical") continue;
+      new G4PVPlacement(0, pv->GetTranslation(), blockLV, "ECalReadoutPhysical", ghostWorldLV, false, pv->GetCopyNo(), false);
+    }
+  }
+
+  // HCal touchable: section (0) / tower envelope (1)
+  if(HCalPV && fHCalSections > 0)
+  {
+    auto towerS = static_cast<const G4Box*>(HCalPV->GetLogicalVolume()->GetSolid());
+    G4double dx = towerS->GetXHalfLength();
+    G4double dy = towerS->GetYHalfLength();
+    G4double dz = towerS->GetZHalfLength();
+
+    auto towerLV = new G4LogicalVolume(new G4Box("HCalReadoutSolid", dx, dy, dz), nullptr, "HCalReadoutLogical");
+    auto sectionLV = new G4LogicalVolume(new G4Box("HCalReadoutSectionSolid", dx, dy, dz/fHCalSections), nullptr, "HCalReadoutSectionLogical");
+    new G4PVReplica("HCalReadoutSectionPhysical", sectionLV, towerLV, kZAxis, fHCalSections, 2.*dz/fHCalSections);
+    towerLV->SetVisAttributes(invis);
+    sectionLV->SetVisAttributes(invis);
+
+    // The four tower variants share the same solid
+    for(std::size_t i = 0; i < massWorldLV->GetNoDaughters(); i++)
+    {
+      auto pv = massWorldLV->GetDaughter(i);
+      if(pv->GetName() != "HCalPhysical") continue;
+      new G4PVPlacement(0, pv->GetTranslation(), towerLV, "HCalReadoutPhysical", ghostWorldLV, false, pv->GetCopyNo(), false);
+    }
+  }
+
+  G4cout << "Readout world: " << fECalSegments << "x" << fECalSegments << " cells per ECal block, "
+         << fHCalSections << " sections per HCal tower" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void ReadoutWorld::ConstructSD()
+{
+  // Called after DetectorConstruction::ConstructSDandField() on the same thread,
+  // so the mass volumes already carry their SDs
+  // or the unified SD of both subsystems (/athena/geometry/unifiedSD)
+  auto sdManager = G4SDManager::GetSDMpointer();
+  auto unifiedSD = static_cast<UnifiedCalorimeterSD*>(sdManager->FindSensitiveDetector("CalorimeterSD", false));
+  auto massVolumes = [unifiedSD](G4VSensitiveDetector* massSD, CellID::Subsystem subsystem)
+  {
+    std::vector<const G4LogicalVolume*> volumes;
+    for(auto lv : *G4LogicalVolumeStore::GetInstance())
+    {
+      auto sd = lv->GetSensitiveDetector();
+      if(!sd) continue;
+      if(sd == massSD || (sd == unifiedSD && unifiedSD->GetSubsystem(lv) == subsystem)) volumes.push_back(lv);
+    }
+    return volumes;
+  };
+
+  // SDs are reused when the geometry is re-initialised
+  auto massECalSD = static_cast<CalorimeterSD*>(sdManager->FindSensitiveDetector("ECalSD", false));
+  auto massECalScale = [massECalSD, unifiedSD](const G4LogicalVolume* lv)
+  {
+    if(unifiedSD && lv->GetSensitiveDetector() == unifiedSD) return unifiedSD->GetEnergyScale(lv);
+    return massECalSD ? massECalSD->GetEnergyScale(lv) : 1.;
+  };
+
+  // A disabled subsystem gets no SD and no hits collection
+  if(fECalSegments > 0)
+  {
+    auto ECalSD = static_cast<CalorimeterSD*>(sdManager->FindSensitiveDetector("ECalReadoutSD", false));
+    if(!ECalSD)
+    {
+      ECalSD = new CalorimeterSD("ECalReadoutSD", "ECalReadoutHitsCollection", CellID::kECalReadout,
+                                 NumECalBlocks*fECalSegments, 2);
+      sdManager->AddNewDetector(ECalSD);
+    }
+    ECalSD->SetLayout(NumECalBlocks*fECalSegments);
+    ECalSD->SetSubdivision(fECalSegments, 1, 0);
+    ECalSD->SetMassVolumes(massVolumes(massECalSD, CellID::kECal));
+    ECalSD->SetEnergyScale(massECalSD ? massECalSD->GetEnergyScale() : 1.);
+    ECalSD->ClearVolumeSettings();
+    for(auto lv : massVolumes(massECalSD, CellID::kECal)) ECalSD->SetEnergyScale(lv, massECalScale(lv));
+    SetSensitiveDetector("ECalReadoutCellLogical", ECalSD);
+  }
+
+  auto massHCalSD = static_cast<CalorimeterSD*>(sdManager->FindSensitiveDetector("HCalSD", false));
+  if(fHCalSections > 0)
+  {
+    auto HCalSD = static_cast<CalorimeterSD*>(sdManager->FindSensitiveDetector("HCalReadoutSD", false));
+    if(!HCalSD)
+    {
+      HCalSD = new CalorimeterSD("HCalReadoutSD", "HCalReadoutHitsCollection", CellID::kHCalReadout,
+                                 NumHCalTowers, 1, 0, fHCalSections);
+      sdManager->AddNewDetector(HCalSD);
+    }
+    HCalSD->SetLayout(NumHCalTowers, fHCalSections);
+    HCalSD->SetMassVolumes(massVolumes(massHCalSD, CellID::kHCal));
+    SetSensitiveDetector("HCalReadoutSectionLogical", HCalSD);
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
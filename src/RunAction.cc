@@ -4,20 +4,30 @@
 
 #include "RunAction.hh"
 #include "Analysis.hh"
+#include "GlobalValues.hh"
+#include "DetectorConstruction.hh"
+#include "CellGeometryTable.hh"
+#include "ConstructionProfiler.hh"
 
 #include "G4Run.hh"
 #include "G4RunManager.hh"
+#include "G4AccumulableManager.hh"
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 RunAction::RunAction()
- : G4UserRunAction()
+ : G4UserRunAction(),
+   fECalEdep(0.),
+   fNofEvents(0)
 { 
   // set printing event number per each event
   G4RunManager::GetRunManager()->SetPrintProgress(0);     
 
+  // Register accumulable to the accumulable manager
+  G4AccumulableManager::Instance()->RegisterAccumulable(fECalEdep);
+
   // Create analysis manager
   // The choice of analysis technology is done via selectin of a namespace
   // in Analysis.hh
@@ -36,6 +46,7 @@ RunAction::RunAction()
   analysisManager->CreateNtupleIColumn("ECal_NumHits_Total");
   analysisManager->CreateNtupleIColumn("HCal_NumHits_Total");
   analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("ECal_Npe_Total"); // with /athena/geometry/fiberLightYield
   analysisManager->FinishNtuple();
 
   analysisManager->CreateNtuple("ECalBlocks", "ECalBlocks");
@@ -43,6 +54,8 @@ RunAction::RunAction()
   analysisManager->CreateNtupleIColumn("ECal_BlockXid");
   analysisManager->CreateNtupleIColumn("ECal_BlockYid");
   analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("ECal_CellID");
+  analysisManager->CreateNtupleDColumn("ECal_Npe_Block");
   analysisManager->FinishNtuple();
 
   analysisManager->CreateNtuple("HCalTowers", "HCalTowers");
@@ -50,6 +63,7 @@ RunAction::RunAction()
   analysisManager->CreateNtupleIColumn("HCal_TowerXid");
   analysisManager->CreateNtupleIColumn("HCal_TowerYid");
   analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("HCal_CellID");
   analysisManager->FinishNtuple();
 
   analysisManager->CreateNtuple("HCalLayers", "HCalLayers");
@@ -59,8 +73,44 @@ RunAction::RunAction()
   analysisManager->CreateNtupleIColumn("HCal_TowerXid");
   analysisManager->CreateNtupleIColumn("HCal_TowerYid");
   analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("HCal_CellID");
+  analysisManager->FinishNtuple();
+
+  // Readout cells of the parallel world, only touched cells
+  analysisManager->CreateNtuple("ECalReadout", "ECalReadout");
+  analysisManager->CreateNtupleDColumn("ECal_Edep_Cell");
+  analysisManager->CreateNtupleIColumn("ECal_CellXid");
+  analysisManager->CreateNtupleIColumn("ECal_CellYid");
+  analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("ECal_CellID");
+  analysisManager->FinishNtuple();
+
+  analysisManager->CreateNtuple("HCalReadout", "HCalReadout");
+  analysisManager->CreateNtupleDColumn("HCal_Edep_Section");
+  analysisManager->CreateNtupleIColumn("HCal_Sectionid");
+  analysisManager->CreateNtupleIColumn("HCal_TowerXid");
+  analysisManager->CreateNtupleIColumn("HCal_TowerYid");
+  analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("HCal_CellID");
+  analysisManager->FinishNtuple();
+
+  // ECal cells below block level, filled with /athena/geometry/ecalGranularity
+  analysisManager->CreateNtuple("ECalSubCells", "ECalSubCells");
+  analysisManager->CreateNtupleDColumn("ECal_Edep_SubCell");
+  analysisManager->CreateNtupleIColumn("ECal_BlockXid");
+  analysisManager->CreateNtupleIColumn("ECal_BlockYid");
+  analysisManager->CreateNtupleIColumn("ECal_FiberGroup");
+  analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("ECal_CellID");
   analysisManager->FinishNtuple();
 
+  // Deposits per integration window of the touched cells, filled with /athena/geometry/timeWindows > 1
+  analysisManager->CreateNtuple("CellWindows", "CellWindows");
+  analysisManager->CreateNtupleDColumn("Edep_Window");
+  analysisManager->CreateNtupleIColumn("Window");
+  analysisManager->CreateNtupleIColumn("eventID");
+  analysisManager->CreateNtupleDColumn("CellID");
+  analysisManager->FinishNtuple();
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -72,19 +122,66 @@ RunAction::~RunAction()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::BeginOfRunAction(const G4Run* /*run*/)
+void RunAction::BeginOfRunAction(const G4Run* run)
 { 
+  // reset accumulables to their initial values
+  G4AccumulableManager::Instance()->Reset();
+
+  // The sampling structure can change between runs, see DetectorConstruction
+  if(isMaster)
+    G4cout << "Run " << run->GetRunID() << ": " << GlobalValues::NumHCalTowers << "x" << GlobalValues::NumHCalTowers
+           << " HCal towers with " << GlobalValues::NumHCalLayers << " layers, "
+           << GlobalValues::NumECalBlocks << "x" << GlobalValues::NumECalBlocks << " ECal blocks" << G4endl;
+
+  // The geometry is closed now, so the voxels can be inventoried
+  if(isMaster)
+  {
+    auto detector = static_cast<const DetectorConstruction*>(
+      G4RunManager::GetRunManager()->GetUserDetectorConstruction());
+    detector->ReportConstruction();
+    fRunTimer.Start();
+  }
+
+  // Calibration runs only need the accumulated energy
+  if(GlobalValues::ECalCalibrationRun) return;
+
   // Get analysis manager
   auto analysisManager = G4AnalysisManager::Instance();
 
   // Open an output file
   analysisManager->OpenFile(analysisManager->GetFileName()); // File name set via macro
+
+  // Cell geometry table next to the output file, see CellGeometry
+  if(isMaster)
+  {
+    G4String tableName = analysisManager->GetFileName();
+    if(tableName.size() > 5 && tableName.substr(tableName.size() - 5) == ".root") tableName.erase(tableName.size() - 5);
+    tableName += "_cells.txt";
+    G4int nCells = CellGeometryTable::Write(tableName);
+    if(nCells > 0) G4cout << "Cell geometry table of " << nCells << " cells written to " << tableName << G4endl;
+  }
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
-void RunAction::EndOfRunAction(const G4Run* /*run*/)
+void RunAction::EndOfRunAction(const G4Run* run)
 {
+  // Merge accumulables
+  G4AccumulableManager::Instance()->Merge();
+  fNofEvents = run->GetNumberOfEvent();
+
+  // Throughput of the run, the construction is reported separately
+  if(isMaster)
+  {
+    fRunTimer.Stop();
+    G4double time = fRunTimer.GetRealElapsed();
+    G4cout << "Run " << run->GetRunID() << " performance: " << fNofEvents << " events in " << time << " s, "
+           << (time > 0. ? fNofEvents/time : 0.) << " events/s, "
+           << ConstructionProfiler::GetResidentMemory()/1.e6 << " MB resident" << G4endl;
+  }
+
+  if(GlobalValues::ECalCalibrationRun) return;
+
   // print histogram statistics
   //
   auto analysisManager = G4AnalysisManager::Instance();
@@ -112,3 +209,10 @@ void RunAction::EndOfRunAction(const G4Run* /*run*/)
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double RunAction::GetMeanECalEdep() const
+{
+  return fNofEvents > 0 ? fECalEdep.GetValue()/fNofEvents : 0.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,119 @@
+/// \file SDBenchmark.cc
+/// \brief Implementation of the SDBenchmark class
+
+#include "SDBenchmark.hh"
+#include "CalorimeterSD.hh"
+#include "ECalFiberParameterisation.hh"
+#include "ECalLatticeNavigation.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4VSolid.hh"
+#include "G4Navigator.hh"
+#include "G4TouchableHistory.hh"
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4DynamicParticle.hh"
+#include "G4Electron.hh"
+#include "G4Timer.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SDBenchmark::Run(G4VPhysicalVolume* worldPV, CalorimeterSD* sd,
+                      const std::vector<G4LogicalVolume*>& volumes, G4int nSteps, G4int nTouchables)
+{
+  auto worldLV = worldPV->GetLogicalVolume();
+  G4Navigator navigator;
+  navigator.SetWorldVolume(worldPV);
+  auto blockLV = G4LogicalVolumeStore::GetInstance()->GetVolume("ECalLogical", false);
+  if(blockLV && blockLV->CharacteriseDaughters() == kExternal)
+  {
+    auto fiberPV = blockLV->GetDaughter(0);
+    auto param = static_cast<ECalFiberParameterisation*>(fiberPV->GetParameterisation());
+    navigator.SetExternalNavigation(new ECalLatticeNavigation(fiberPV, param));
+  }
+
+  // Touchables of random points in the sensitive volumes
+  std::vector<G4TouchableHandle> touchables;
+  for(G4long attempt = 0; attempt < 1000L*nTouchables && G4int(touchables.size()) < nTouchables; attempt++)
+  {
+    auto placement = worldLV->GetDaughter(std::size_t(G4UniformRand()*worldLV->GetNoDaughters()));
+    G4ThreeVector lo, hi;
+    placement->GetLogicalVolume()->GetSolid()->BoundingLimits(lo, hi);
+    G4ThreeVector point = placement->GetTranslation()
+      + G4ThreeVector(lo.x() + G4UniformRand()*(hi.x() - lo.x()),
+                      lo.y() + G4UniformRand()*(hi.y() - lo.y()),
+                      lo.z() + G4UniformRand()*(hi.z() - lo.z()));
+    auto volume = navigator.LocateGlobalPointAndSetup(point, nullptr, false, false);
+    if(!volume || std::find(volumes.begin(), volumes.end(), volume->GetLogicalVolume()) == volumes.end()) continue;
+    touchables.push_back(G4TouchableHandle(navigator.CreateTouchableHistory()));
+  }
+  if(touchables.empty())
+  {
+    G4ExceptionDescription msg;
+    msg << "No sensitive volume of " << sd->GetName() << " found in the geometry.";
+    G4Exception("SDBenchmark::Run()",
+      "MyCode0021", JustWarning, msg);
+    return;
+  }
+
+  // One charged step, moved from touchable to touchable
+  G4Track track(new G4DynamicParticle(G4Electron::Definition(), G4ThreeVector(0., 0., 1.), 1.*MeV), 0., G4ThreeVector());
+  G4Step step;
+  track.SetStep(&step);
+  step.SetTrack(&track);
+  step.SetTotalEnergyDeposit(0.1*MeV);
+  step.SetStepLength(0.1*mm);
+  auto preStepPoint = step.GetPreStepPoint();
+
+  const char* modeNames[3] = {"per-step lookup", "volume table", "batched"};
+  G4double timePerStep[3] = {0., 0., 0.};
+  G4double edep[3] = {0., 0., 0.};
+  std::size_t nHits[3] = {0, 0, 0};
+  G4int batchSize = sd->GetBatchSize();
+
+  for(G4int mode = 0; mode < 3; mode++)
+  {
+    sd->SetVolumeTable(mode >= 1);
+    sd->SetBatchSize(mode == 2 ? (batchSize > 0 ? batchSize : 256) : 0);
+    CalorHitsCollection hits(sd->GetName(), "SDBenchmarkHits");
+    sd->SetHitsCollection(&hits);
+
+    G4Timer timer;
+    timer.Start();
+    for(G4int i = 0; i < nSteps; i++)
+    {
+      preStepPoint->SetTouchableHandle(touchables[i % touchables.size()]);
+      sd->ProcessHits(&step, nullptr);
+    }
+    sd->FlushBatch();
+    timer.Stop();
+    timePerStep[mode] = nSteps ? timer.GetRealElapsed()/nSteps : 0.;
+    edep[mode] = hits[0]->GetEdep();
+    nHits[mode] = hits.entries();
+  }
+  sd->SetVolumeTable(true);
+  sd->SetBatchSize(batchSize);
+
+  G4cout << G4endl << sd->GetName() << " ProcessHits benchmark, " << nSteps << " steps in "
+         << touchables.size() << " touchables:" << G4endl;
+  for(G4int mode = 0; mode < 3; mode++)
+  {
+    G4cout << "  " << modeNames[mode] << ": " << timePerStep[mode]*1.e9 << " ns/step, "
+           << nHits[mode] - 1 << " cells, " << edep[mode]/MeV << " MeV" << G4endl;
+  }
+  if(timePerStep[1] > 0.) G4cout << "  speed-up: " << timePerStep[0]/timePerStep[1] << G4endl;
+  if(timePerStep[2] > 0.) G4cout << "  speed-up batched: " << timePerStep[0]/timePerStep[2] << G4endl;
+  // The batches are summed per quenching model, equal up to rounding
+  if(edep[0] != edep[1] || nHits[0] != nHits[1] || nHits[0] != nHits[2]
+     || std::abs(edep[2] - edep[0]) > 1.e-9*std::abs(edep[0]))
+    G4cout << "  WARNING: the modes scored differently" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,33 @@
+/// \file StackingAction.cc
+/// \brief Implementation of the StackingAction class
+
+#include "StackingAction.hh"
+#include "GlobalValues.hh"
+
+#include "G4Track.hh"
+
+using namespace GlobalValues;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StackingAction::StackingAction()
+ : G4UserStackingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StackingAction::~StackingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track)
+{
+  if(NumTimeWindows <= 0 || !KillLateTracks) return fUrgent;
+
+  // Secondaries of late steps would deposit outside the windows
+  if(track->GetGlobalTime() > TimeWindowStart + NumTimeWindows*TimeWindowWidth) return fKill;
+  return fUrgent;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
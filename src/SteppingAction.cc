@@ -0,0 +1,34 @@
+/// \file SteppingAction.cc
+/// \brief Implementation of the SteppingAction class
+
+#include "SteppingAction.hh"
+#include "GlobalValues.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+
+using namespace GlobalValues;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SteppingAction::SteppingAction()
+ : G4UserSteppingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+SteppingAction::~SteppingAction()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void SteppingAction::UserSteppingAction(const G4Step* step)
+{
+  if(NumTimeWindows <= 0 || !KillLateTracks) return;
+
+  // The SDs have seen this step already, its secondaries are not stacked, see StackingAction
+  if(step->GetPostStepPoint()->GetGlobalTime() > TimeWindowStart + NumTimeWindows*TimeWindowWidth)
+    step->GetTrack()->SetTrackStatus(fStopAndKill);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
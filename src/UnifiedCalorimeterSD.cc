@@ -0,0 +1,207 @@
+/// \file UnifiedCalorimeterSD.cc
+/// \brief Implementation of the UnifiedCalorimeterSD class
+
+#include "UnifiedCalorimeterSD.hh"
+#include "GlobalValues.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4Step.hh"
+#include "G4LogicalVolume.hh"
+#include "G4Material.hh"
+#include "G4ios.hh"
+
+#include <algorithm>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+UnifiedCalorimeterSD::UnifiedCalorimeterSD(const G4String& name)
+ : G4VSensitiveDetector(name)
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+UnifiedCalorimeterSD::~UnifiedCalorimeterSD()
+{}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::SetLayout(CellID::Subsystem subsystem, G4int nofXY, G4int nofLayers)
+{
+  fSections[subsystem].nofXY = nofXY;
+  fSections[subsystem].nofLayers = nofLayers;
+  Resize();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::size_t UnifiedCalorimeterSD::GetNofCells(CellID::Subsystem subsystem) const
+{
+  const auto& section = fSections[subsystem];
+  return std::size_t(section.nofXY)*section.nofXY*section.nofLayers;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::Resize()
+{
+  std::size_t nofCells = 0;
+  for(G4int subsystem = 0; subsystem < kNofSubsystems; subsystem++)
+  {
+    fSections[subsystem].offset = nofCells;
+    nofCells += GetNofCells(CellID::Subsystem(subsystem));
+  }
+  fEdep.assign(nofCells, 0.);
+  fTrackLength.assign(nofCells, 0.);
+  fNumHits.assign(nofCells, 0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::AddVolume(const G4LogicalVolume* volume, CellID::Subsystem subsystem,
+                                     G4int cellDepth, G4int layerDepth, G4double energyScale)
+{
+  VolumeRecord record;
+  record.valid = true;
+  record.sensitive = true;
+  record.subsystem = subsystem;
+  record.cellDepth = cellDepth;
+  record.layerDepth = layerDepth;
+  record.energyScale = energyScale;
+  fVolumes[volume] = record;
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::ClearVolumes()
+{
+  fVolumes.clear();
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::SetQuenching(const G4Material* material, const Quenching::Parameters& parameters)
+{
+  auto& quenching = fMaterialQuenching[material];
+  quenching = parameters;
+  if ( parameters.model == Quenching::kTabulated ) {
+    if ( ! parameters.table || parameters.table->factor.size() < 2 ) {
+      G4ExceptionDescription msg;
+      msg << "The quenching table of " << material->GetName() << " needs at least 2 entries";
+      G4Exception("UnifiedCalorimeterSD::SetQuenching()",
+        "MyCode0023", FatalException, msg);
+    }
+    fQuenchingTables[material] = *parameters.table;
+    quenching.table = &fQuenchingTables[material];
+  }
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::ClearQuenching()
+{
+  fMaterialQuenching.clear();
+  fQuenchingTables.clear();
+  fVolumeTable.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int UnifiedCalorimeterSD::GetSubsystem(const G4LogicalVolume* volume) const
+{
+  auto record = fVolumes.find(volume);
+  return ( record != fVolumes.end() ) ? record->second.subsystem : 0;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double UnifiedCalorimeterSD::GetEnergyScale(const G4LogicalVolume* volume) const
+{
+  auto record = fVolumes.find(volume);
+  return ( record != fVolumes.end() ) ? record->second.energyScale : 1.;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const UnifiedCalorimeterSD::VolumeRecord& UnifiedCalorimeterSD::GetRecord(const G4LogicalVolume* volume)
+{
+  std::size_t id = volume->GetInstanceID();
+  if ( id >= fVolumeTable.size() ) fVolumeTable.resize(id + 1);
+  auto& record = fVolumeTable[id];
+  if ( ! record.valid ) {
+    auto added = fVolumes.find(volume);
+    if ( added != fVolumes.end() ) record = added->second;
+    record.valid = true;
+    auto material = volume->GetMaterial();
+    auto quenching = fMaterialQuenching.find(material);
+    if ( quenching != fMaterialQuenching.end() ) {
+      record.quenching = quenching->second;
+    }
+    else {
+      record.quenching.birks = material->GetIonisation()->GetBirksConstant();
+      record.quenching.model = ( record.quenching.birks > 0. ) ? Quenching::kBirks : Quenching::kNone;
+    }
+    record.quench = Quenching::Select(record.quenching.model);
+  }
+  return record;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void UnifiedCalorimeterSD::Initialize(G4HCofThisEvent*)
+{
+  std::fill(fEdep.begin(), fEdep.end(), 0.);
+  std::fill(fTrackLength.begin(), fTrackLength.end(), 0.);
+  std::fill(fNumHits.begin(), fNumHits.end(), 0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool UnifiedCalorimeterSD::ProcessHits(G4Step* step, G4TouchableHistory*)
+{
+  // energy deposit
+  auto edep = step->GetTotalEnergyDeposit();
+
+  // step length, only used for the quenching, which applies only to charged particles
+  G4double charge = step->GetTrack()->GetDefinition()->GetPDGCharge();
+  G4double stepLength = ( charge != 0. ) ? step->GetStepLength() : 0.;
+  if ( edep==0. && stepLength == 0. ) return true;
+
+  // Deposits outside the integration windows are not seen, the arrays hold the sum of the windows
+  if ( GlobalValues::NumTimeWindows > 0 ) {
+    auto time = step->GetPreStepPoint()->GetGlobalTime() - GlobalValues::TimeWindowStart;
+    if ( time < 0. || time >= GlobalValues::NumTimeWindows*GlobalValues::TimeWindowWidth ) return true;
+  }
+
+  auto touchable = step->GetPreStepPoint()->GetTouchable();
+  const auto& record = GetRecord(touchable->GetVolume()->GetLogicalVolume());
+  if ( ! record.sensitive ) return true;
+  const auto& section = fSections[record.subsystem];
+
+  // Get calorimeter cell
+  auto copyNo = touchable->GetCopyNumber(record.cellDepth);
+  auto x = CellID::CopyX(copyNo);
+  auto y = CellID::CopyY(copyNo);
+  G4int layer = ( record.layerDepth >= 0 ) ? touchable->GetReplicaNumber(record.layerDepth) : 0;
+  if ( x >= section.nofXY || y >= section.nofXY || layer < 0 || layer >= section.nofLayers ) {
+    G4ExceptionDescription msg;
+    msg << "Cannot access cell " << x << " " << y << " " << layer << " of subsystem " << record.subsystem;
+    G4Exception("UnifiedCalorimeterSD::ProcessHits()",
+      "MyCode0004", FatalException, msg);
+  }
+  auto cell = section.offset + (std::size_t(x)*section.nofXY + y)*section.nofLayers + layer;
+
+  // Quenching model of the material, Birks' law for organic scintillators by default
+  G4double dEdx = ( stepLength > 0. ) ? edep/stepLength : 0.;
+  edep = record.quench(record.quenching, edep, dEdx);
+  edep *= record.energyScale;
+
+  fEdep[cell] += edep;
+  fTrackLength[cell] += stepLength;
+  fNumHits[cell]++;
+
+  return true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,198 @@
+/// \file VisLevelOfDetail.cc
+/// \brief Implementation of the VisLevelOfDetail class
+
+#include "VisLevelOfDetail.hh"
+#include "CalorHit.hh"
+#include "CellID.hh"
+
+#include "G4GenericMessenger.hh"
+#include "G4UImanager.hh"
+#include "G4VisManager.hh"
+#include "G4VViewer.hh"
+#include "G4Scene.hh"
+#include "G4RunManager.hh"
+#include "G4Run.hh"
+#include "G4Event.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4SDManager.hh"
+#include "G4LogicalVolumeStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Box.hh"
+#include "G4VisAttributes.hh"
+#include "G4Colour.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <utility>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VisLevelOfDetail::VisLevelOfDetail()
+ : fMessenger(nullptr),
+   fMaxDetailedBlocks(4),
+   fShowerBlocks(4),
+   fNofScenes(0)
+{
+  DefineCommands();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+VisLevelOfDetail::~VisLevelOfDetail()
+{
+  delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VisLevelOfDetail::DefineCommands()
+{
+  fMessenger = new G4GenericMessenger(this, "/athena/vis/", "Visualisation control");
+
+  auto& lodCmd
+    = fMessenger->DeclareMethod("lod", &VisLevelOfDetail::Update,
+        "Draw towers and blocks as envelopes, with the fibers of the viewed blocks\n"
+        "when zoomed in and of the blocks hit in the kept events.");
+  lodCmd.SetStates(G4State_Idle);
+
+  auto& maxBlocksCmd
+    = fMessenger->DeclareProperty("maxDetailedBlocks", fMaxDetailedBlocks,
+        "Viewed blocks are drawn with their fibers if there are at most this many.");
+  maxBlocksCmd.SetParameterName("n", false);
+  maxBlocksCmd.SetRange("n>=0");
+
+  auto& showerBlocksCmd
+    = fMessenger->DeclareProperty("showerBlocks", fShowerBlocks,
+        "Number of blocks with most energy in the kept events drawn with their fibers.");
+  showerBlocksCmd.SetParameterName("n", false);
+  showerBlocksCmd.SetRange("n>=0");
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VisLevelOfDetail::SetVisAttributes() const
+{
+  // Translucent blocks so that the fibers of detailed blocks show through.
+  // Fibers are only reached by the scene models of detailed blocks.
+  auto store = G4LogicalVolumeStore::GetInstance();
+  auto setVis = [store](const G4String& name, const G4Colour& colour, G4bool solid)
+  {
+    auto lv = store->GetVolume(name, false);
+    if(!lv) return;
+    G4VisAttributes visAtt(colour);
+    visAtt.SetVisibility(true);
+    visAtt.SetForceSolid(solid);
+    lv->SetVisAttributes(visAtt);
+  };
+
+  setVis("ECalLogical", G4Colour(0., 0., 1., 0.3), true);
+  setVis("ECalMixtureLogical", G4Colour(0., 0., 1., 0.3), true);
+  setVis("ECal_FiberCladdingLogical", G4Colour::Cyan(), false);
+  setVis("ECal_FiberLogical", G4Colour::Green(), true);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4int> VisLevelOfDetail::GetViewedBlocks() const
+{
+  std::vector<G4int> blocks;
+  auto visManager = G4VisManager::GetInstance();
+  auto viewer = visManager ? visManager->GetCurrentViewer() : nullptr;
+  auto scene = visManager ? visManager->GetCurrentScene() : nullptr;
+  if(!viewer || !scene) return blocks;
+
+  const auto& viewParameters = viewer->GetViewParameters();
+  G4Point3D target = scene->GetStandardTargetPoint() + viewParameters.GetCurrentTargetPoint();
+  G4double viewedRadius = scene->GetExtent().GetExtentRadius()/viewParameters.GetZoomFactor();
+
+  auto worldLV = G4LogicalVolumeStore::GetInstance()->GetVolume("WorldLogical", false);
+  if(!worldLV) return blocks;
+  for(std::size_t i = 0; i < worldLV->GetNoDaughters(); i++)
+  {
+    auto pv = worldLV->GetDaughter(i);
+    if(pv->GetName() != "ECalPhysical") continue;
+    auto box = static_cast<const G4Box*>(pv->GetLogicalVolume()->GetSolid());
+    G4double halfDiagonal = std::hypot(box->GetXHalfLength(), box->GetYHalfLength());
+    G4ThreeVector position = pv->GetTranslation();
+    G4double distance = std::hypot(position.x() - target.x(), position.y() - target.y());
+    if(distance - halfDiagonal < viewedRadius) blocks.push_back(pv->GetCopyNo());
+  }
+
+  // Zoomed out, envelopes only
+  if(G4int(blocks.size()) > fMaxDetailedBlocks) blocks.clear();
+  return blocks;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4int> VisLevelOfDetail::GetShowerBlocks() const
+{
+  std::vector<G4int> blocks;
+  auto run = G4RunManager::GetRunManager()->GetCurrentRun();
+  auto events = run ? run->GetEventVector() : nullptr;
+  G4int hcID = G4SDManager::GetSDMpointer()->GetCollectionID("ECalHitsCollection");
+  if(!events || hcID < 0 || fShowerBlocks == 0) return blocks;
+
+  // Entry 0 holds the sums, then one hit per touched block, or per fiber group of
+  // a finer ecalGranularity, summed per block by copy number
+  std::map<G4int, G4double> blockEdep;
+  for(auto event : *events)
+  {
+    auto hce = event->GetHCofThisEvent();
+    auto hc = hce ? static_cast<CalorHitsCollection*>(hce->GetHC(hcID)) : nullptr;
+    if(!hc) continue;
+    for(std::size_t n = 1; n < hc->entries(); n++)
+    {
+      auto id = (*hc)[n]->GetCellID();
+      blockEdep[CellID::CopyNumber(CellID::X(id), CellID::Y(id))] += (*hc)[n]->GetEdep();
+    }
+  }
+
+  std::vector<std::pair<G4double, G4int>> ranked;
+  for(const auto& block : blockEdep) ranked.emplace_back(block.second, block.first);
+  std::sort(ranked.rbegin(), ranked.rend());
+  for(std::size_t i = 0; i < ranked.size() && G4int(i) < fShowerBlocks; i++)
+    blocks.push_back(ranked[i].second);
+  return blocks;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VisLevelOfDetail::Update()
+{
+  auto visManager = G4VisManager::GetInstance();
+  if(!visManager || !visManager->GetCurrentViewer())
+  {
+    G4ExceptionDescription msg;
+    msg << "No current viewer, open one (e.g. /vis/open OGL) before /athena/vis/lod.";
+    G4Exception("VisLevelOfDetail::Update()",
+      "MyCode0018", JustWarning, msg);
+    return;
+  }
+
+  auto blocks = GetViewedBlocks();
+  for(auto copyNo : GetShowerBlocks())
+    if(std::find(blocks.begin(), blocks.end(), copyNo) == blocks.end()) blocks.push_back(copyNo);
+
+  SetVisAttributes();
+
+  // A scene cannot be emptied, so each update gets a new one
+  auto UImanager = G4UImanager::GetUIpointer();
+  G4String scene = "athena-lod-" + std::to_string(fNofScenes++);
+  UImanager->ApplyCommand("/vis/scene/create " + scene);
+  UImanager->ApplyCommand("/vis/scene/add/volume WorldPhysical -1 1");
+  for(auto copyNo : blocks)
+    UImanager->ApplyCommand("/vis/scene/add/volume ECalPhysical " + std::to_string(copyNo) + " -1");
+  UImanager->ApplyCommand("/vis/scene/add/trajectories smooth");
+  UImanager->ApplyCommand("/vis/scene/add/hits");
+  UImanager->ApplyCommand("/vis/scene/endOfEventAction accumulate");
+  UImanager->ApplyCommand("/vis/sceneHandler/attach " + scene);
+
+  G4cout << "Level-of-detail scene " << scene << ": " << blocks.size()
+         << " ECal blocks drawn with their fibers" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,269 @@
+/// \file VoxelTuner.cc
+/// \brief Implementation of the VoxelTuner class
+
+#include "VoxelTuner.hh"
+
+#include "G4LogicalVolumeStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4SmartVoxelHeader.hh"
+#include "G4Navigator.hh"
+#include "G4Timer.hh"
+#include "G4AutoLock.hh"
+#include "Randomize.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+namespace
+{
+  struct Track
+  {
+    G4ThreeVector position;
+    G4ThreeVector direction;
+  };
+
+  struct Setting
+  {
+    G4bool optimise;
+    G4double smartless;
+  };
+
+  std::atomic<G4bool> recording(false);
+  G4Mutex tracksMutex = G4MUTEX_INITIALIZER;
+  std::vector<Track> tracks;
+  G4long nSeenTracks = 0;
+  G4int maxSampledTracks = 0;
+
+  // A pure replica fills its mother whatever the settings
+  G4bool HasReplicaOnly(const G4LogicalVolume* lv)
+  {
+    return lv->GetNoDaughters() == 1 && lv->GetDaughter(0)->IsReplicated()
+        && !lv->GetDaughter(0)->IsParameterised();
+  }
+
+  // A single replicated or parameterised daughter is always voxelised by G4GeometryManager
+  G4bool AlwaysVoxelised(const G4LogicalVolume* lv)
+  {
+    return lv->GetNoDaughters() == 1 && lv->GetDaughter(0)->IsReplicated();
+  }
+
+  void ApplySetting(G4LogicalVolume* lv, const Setting& setting)
+  {
+    lv->SetOptimisation(setting.optimise);
+    lv->SetSmartless(setting.smartless);
+    delete lv->GetVoxelHeader();
+    lv->SetVoxelHeader((setting.optimise || AlwaysVoxelised(lv)) ? new G4SmartVoxelHeader(lv) : nullptr);
+  }
+
+  // Geometric transport of the sampled tracks until they leave the world
+  G4double TimeTracks(G4VPhysicalVolume* worldPV, G4int maxSteps, G4long& nSteps)
+  {
+    G4Navigator navigator;
+    navigator.SetWorldVolume(worldPV);
+    nSteps = 0;
+
+    G4Timer timer;
+    timer.Start();
+    for(const auto& track : tracks)
+    {
+      G4ThreeVector point = track.position;
+      const G4ThreeVector& direction = track.direction;
+      if(!navigator.LocateGlobalPointAndSetup(point, &direction, false, false)) continue;
+
+      for(G4int step = 0; step < maxSteps; step++)
+      {
+        G4double safety = 0.;
+        G4double length = navigator.ComputeStep(point, direction, kInfinity, safety);
+        if(length == kInfinity) break;
+        point += length*direction;
+        nSteps++;
+
+        navigator.SetGeometricallyLimitedStep();
+        if(!navigator.LocateGlobalPointAndSetup(point, &direction, true)) break;
+      }
+    }
+    timer.Stop();
+    return timer.GetRealElapsed();
+  }
+
+  G4double BestTime(G4VPhysicalVolume* worldPV, G4int nRepetitions, G4int maxSteps)
+  {
+    G4double best = DBL_MAX;
+    G4long nSteps = 0;
+    for(G4int i = 0; i < nRepetitions; i++) best = std::min(best, TimeTracks(worldPV, maxSteps, nSteps));
+    return best;
+  }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VoxelTuner::StartRecording(G4int maxTracks)
+{
+  G4AutoLock lock(&tracksMutex);
+  tracks.clear();
+  tracks.reserve(maxTracks);
+  nSeenTracks = 0;
+  maxSampledTracks = maxTracks;
+  recording = true;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VoxelTuner::StopRecording()
+{
+  recording = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4bool VoxelTuner::IsRecording()
+{
+  return recording;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VoxelTuner::RecordTrack(const G4ThreeVector& position, const G4ThreeVector& direction)
+{
+  // Drawn outside the lock from the engine of this thread
+  G4double random = G4UniformRand();
+
+  G4AutoLock lock(&tracksMutex);
+  nSeenTracks++;
+  if(G4int(tracks.size()) < maxSampledTracks)
+  {
+    tracks.push_back({position, direction});
+    return;
+  }
+  G4long i = G4long(random*nSeenTracks);
+  if(i < maxSampledTracks) tracks[i] = {position, direction};
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void VoxelTuner::Run(G4VPhysicalVolume* worldPV, const G4String& settingsFile,
+                     G4int nRepetitions, G4int maxSteps)
+{
+  if(tracks.empty())
+  {
+    G4ExceptionDescription msg;
+    msg << "No tracks were recorded, the voxels are not tuned.";
+    G4Exception("VoxelTuner::Run()",
+      "MyCode0015", JustWarning, msg);
+    return;
+  }
+
+  // The benchmark navigator has no external navigation, so lattice mothers
+  // are navigated through their parameterisation while they are tuned
+  std::vector<G4LogicalVolume*> mothers, externals;
+  for(auto lv : *G4LogicalVolumeStore::GetInstance())
+  {
+    if(lv->CharacteriseDaughters() == kExternal && lv->GetDaughter(0)->IsParameterised())
+    {
+      externals.push_back(lv);
+      lv->ChangeDaughtersType(kParameterised);
+    }
+    if(lv->GetVoxelHeader() && !HasReplicaOnly(lv)) mothers.push_back(lv);
+  }
+
+  std::vector<Setting> candidates;
+  candidates.push_back({false, 2.});
+  const G4double smartless[] = {0.5, 1., 2., 4., 8.};
+  for(auto value : smartless) candidates.push_back({true, value});
+
+  G4long nSteps = 0;
+  TimeTracks(worldPV, maxSteps, nSteps); // warm-up
+  G4double initialTime = BestTime(worldPV, nRepetitions, maxSteps);
+  G4cout << G4endl << "Voxel tuning with " << tracks.size() << " tracks (" << nSteps
+         << " steps), " << initialTime << " s with the current settings:" << G4endl;
+
+  std::vector<Setting> best;
+  for(auto lv : mothers)
+  {
+    Setting current = {lv->IsToOptimise(), lv->GetSmartless()};
+    Setting bestSetting = current;
+    G4double bestTime = BestTime(worldPV, nRepetitions, maxSteps);
+    G4double currentTime = bestTime;
+
+    for(const auto& candidate : candidates)
+    {
+      if(!candidate.optimise && AlwaysVoxelised(lv)) continue;
+      if(candidate.optimise == current.optimise && candidate.smartless == current.smartless) continue;
+      ApplySetting(lv, candidate);
+      G4double time = BestTime(worldPV, nRepetitions, maxSteps);
+      if(time < bestTime)
+      {
+        bestTime = time;
+        bestSetting = candidate;
+      }
+    }
+    ApplySetting(lv, bestSetting);
+    best.push_back(bestSetting);
+
+    G4cout << "  " << std::setw(28) << std::left << lv->GetName() << std::right
+           << " optimise " << bestSetting.optimise << ", smartless " << std::setw(4) << bestSetting.smartless
+           << ": " << currentTime << " s -> " << bestTime << " s" << G4endl;
+  }
+
+  for(auto lv : externals) lv->ChangeDaughtersType(kExternal);
+
+  if(settingsFile.empty()) return;
+
+  std::ofstream output(settingsFile);
+  if(!output)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot write the voxel settings " << settingsFile;
+    G4Exception("VoxelTuner::Run()",
+      "MyCode0015", JustWarning, msg);
+    return;
+  }
+  output << "# logical_volume optimise smartless\n";
+  for(std::size_t i = 0; i < mothers.size(); i++)
+    output << mothers[i]->GetName() << " " << best[i].optimise << " " << best[i].smartless << "\n";
+  G4cout << "Voxel settings written to " << settingsFile << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int VoxelTuner::ApplySettings(const G4String& settingsFile)
+{
+  std::ifstream input(settingsFile);
+  if(!input)
+  {
+    G4ExceptionDescription msg;
+    msg << "Cannot read the voxel settings " << settingsFile
+        << ", the default voxelisation is used.";
+    G4Exception("VoxelTuner::ApplySettings()",
+      "MyCode0016", JustWarning, msg);
+    return 0;
+  }
+
+  G4int nSet = 0;
+  std::string line;
+  while(std::getline(input, line))
+  {
+    if(line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    std::string name;
+    G4bool optimise;
+    G4double smartless;
+    if(!(fields >> name >> optimise >> smartless)) continue;
+
+    auto lv = G4LogicalVolumeStore::GetInstance()->GetVolume(name, false);
+    if(!lv) continue;
+    lv->SetOptimisation(optimise);
+    lv->SetSmartless(smartless);
+    nSet++;
+  }
+  return nSet;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......